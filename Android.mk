@@ -1,7 +1,7 @@
 LOCAL_PATH:= $(call my-dir)
 include $(CLEAR_VARS)
 
-LOCAL_SRC_FILES := cpuloadgen.c timers_b.c
+LOCAL_SRC_FILES := cpuloadgen.c clg.c stats.c output.c perfcnt.c verify.c sysfs.c cpufreq.c thermal.c metrics.c trace.c histogram.c sim.c kernel.c kernel_fma.c bench.c overhead.c freqinv.c uclamp.c steal.c step.c idlegap.c wakeup.c kernel_mm.c kernel_alloc.c
 
 LOCAL_CFLAGS := -Wall -pthread
 
@@ -16,3 +16,15 @@ LOCAL_MODULE_TAGS := debug
 LOCAL_FORCE_STATIC_EXECUTABLE := true
 
 include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := clg.c stats.c output.c perfcnt.c verify.c sysfs.c cpufreq.c thermal.c metrics.c trace.c histogram.c sim.c kernel.c kernel_fma.c bench.c overhead.c freqinv.c uclamp.c steal.c step.c idlegap.c wakeup.c kernel_mm.c kernel_alloc.c
+
+LOCAL_CFLAGS := -Wall -pthread -fvisibility=hidden
+
+LOCAL_MODULE := libcpuloadgen
+
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)
+
+include $(BUILD_STATIC_LIBRARY)
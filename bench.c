@@ -0,0 +1,241 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			bench.c
+ * @Description			Kernel throughput and core-scaling benchmark
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "cpuloadgen.h"
+#include "clg.h"
+#include "output.h"
+#include "kernel.h"
+#include "bench.h"
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		bench_sleep
+ * @BRIEF		sleep for a given time.
+ * @param[in]		ns: time to sleep, in ns
+ * @DESCRIPTION		sleep for a given time, resuming after signals.
+ *//*------------------------------------------------------------------------ */
+static void bench_sleep(uint64_t ns)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ns / NSEC_PER_SEC;
+	ts.tv_nsec = ns % NSEC_PER_SEC;
+	while (nanosleep(&ts, &ts) != 0)
+		;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		bench_step
+ * @BRIEF		measure a kernel throughput on the first n CPUs.
+ * @RETURNS		0 on success, negative error code otherwise
+ * @param[in]		spec: kernel spec
+ * @param[in]		n: number of loaded CPUs
+ * @param[in]		seconds: measurement time
+ * @param[out]		rates: per-CPU throughput (iterations/s), n entries
+ * @DESCRIPTION		measure a kernel throughput on the first n CPUs, all
+ *			loaded at 100%. Throughput is measured over whole
+ *			frames, as iterations per busy second.
+ *//*------------------------------------------------------------------------ */
+static int bench_step(const char *spec, unsigned int n, long int seconds,
+	double *rates)
+{
+	struct clg_config cfg;
+	struct clg_ctx *ctx;
+	struct clg_counters *c0, c1;
+	int *loads;
+	unsigned int i;
+	int ret;
+
+	loads = malloc(n * sizeof(*loads));
+	c0 = malloc(n * sizeof(*c0));
+	if ((loads == NULL) || (c0 == NULL)) {
+		free(loads);
+		free(c0);
+		return -ENOMEM;
+	}
+	for (i = 0; i < n; i++)
+		loads[i] = 100;
+	cfg.cpu_count = n;
+	cfg.loads = loads;
+	cfg.duration = 0;
+	cfg.period = 0;
+	cfg.kernel = spec;
+	cfg.rates = NULL;
+	cfg.idle = NULL;
+	ret = clg_start(&cfg, &ctx);
+	if (ret != 0)
+		goto out;
+
+	bench_sleep(BENCH_WARMUP_NS);
+	for (i = 0; i < n; i++)
+		clg_stats(ctx, i, &c0[i]);
+	bench_sleep((uint64_t) seconds * NSEC_PER_SEC);
+	for (i = 0; i < n; i++) {
+		clg_stats(ctx, i, &c1);
+		rates[i] = (c1.busy_ns > c0[i].busy_ns) ?
+			(double) (c1.iterations - c0[i].iterations) *
+			NSEC_PER_SEC / (c1.busy_ns - c0[i].busy_ns) : 0.0;
+	}
+	clg_stop(ctx);
+
+out:
+	free(loads);
+	free(c0);
+	return ret;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		bench_kernel
+ * @BRIEF		measure a kernel core-scaling curve.
+ * @RETURNS		0 on success, negative error code otherwise
+ * @param[in]		cpu_count: number of CPUs
+ * @param[in]		spec: kernel spec
+ * @param[in]		seconds: measurement time per step
+ * @DESCRIPTION		measure a kernel throughput on 1, 2, 4 ... cpu_count
+ *			CPUs, and print and record per-CPU and aggregate
+ *			throughput, and scaling efficiency (aggregate
+ *			throughput relative to n times single-CPU throughput).
+ *//*------------------------------------------------------------------------ */
+static int bench_kernel(unsigned int cpu_count, const char *spec,
+	long int seconds)
+{
+	const struct kernel *k;
+	const char *params;
+	char name[KERNEL_SPEC_MAX];
+	double *rates, sum, min, max, single = 0.0, eff;
+	unsigned int n, i;
+	int ret;
+
+	/* Select the variant once, so that all steps run the same one */
+	ret = kernel_find(spec, &k, &params);
+	if (ret != 0)
+		return ret;
+	kernel_spec(k, params, name, sizeof(name));
+	rates = malloc(cpu_count * sizeof(*rates));
+	if (rates == NULL)
+		return -ENOMEM;
+
+	iprintf("Kernel: %s\n", name);
+	iprintf("\t%5s %16s %16s %16s %16s %10s\n", "cores", "min/core (M/s)",
+		"mean/core (M/s)", "max/core (M/s)", "aggregate (M/s)",
+		"efficiency");
+	for (n = 1; n <= cpu_count; n = (n * 2 > cpu_count && n < cpu_count) ?
+		cpu_count : n * 2) {
+		ret = bench_step(name, n, seconds, rates);
+		if (ret != 0)
+			break;
+		sum = 0.0;
+		min = max = rates[0];
+		for (i = 0; i < n; i++) {
+			sum += rates[i];
+			if (rates[i] < min)
+				min = rates[i];
+			if (rates[i] > max)
+				max = rates[i];
+		}
+		if (n == 1)
+			single = sum;
+		eff = (single > 0.0) ? sum / (n * single) : 0.0;
+		iprintf("\t%5u %16.2f %16.2f %16.2f %16.2f %9.1f%%\n", n,
+			min / 1e6, sum / n / 1e6, max / 1e6, sum / 1e6,
+			eff * 100.0);
+
+		output_begin("bench");
+		output_field_str("kernel", name);
+		output_field_int("cores", n);
+		output_field_double("min_per_core", min);
+		output_field_double("mean_per_core", sum / n);
+		output_field_double("max_per_core", max);
+		output_field_double("aggregate", sum);
+		output_field_double("efficiency", eff);
+		output_end();
+	}
+	iprintf("\n");
+	free(rates);
+
+	return ret;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		bench_run
+ * @BRIEF		run the kernel throughput benchmark.
+ * @RETURNS		0 on success, negative error code otherwise
+ * @param[in]		cpu_count: number of CPUs
+ * @param[in]		kernel: kernel spec, NULL: all kernels
+ * @param[in]		seconds: measurement time per step
+ * @DESCRIPTION		run the kernel throughput benchmark on a kernel, or
+ *			on every registered kernel (fastest variant of each).
+ *//*------------------------------------------------------------------------ */
+int bench_run(unsigned int cpu_count, const char *kernel, long int seconds)
+{
+	const struct kernel *k;
+	const char *name, *params;
+	unsigned int i;
+	int ret;
+
+	if ((cpu_count == 0) || (seconds < 1))
+		return -EINVAL;
+
+	iprintf("Benchmarking kernels at 100%% load, %lds per step...\n\n",
+		seconds);
+	if (kernel != NULL)
+		return bench_kernel(cpu_count, kernel, seconds);
+
+	for (i = 0; (name = kernel_name(i)) != NULL; i++) {
+		/* Skip kernels this CPU cannot run at all */
+		if (kernel_find(name, &k, &params) == -ENOTSUP)
+			continue;
+		ret = bench_kernel(cpu_count, name, seconds);
+		if (ret != 0)
+			return ret;
+	}
+
+	return 0;
+}
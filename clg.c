@@ -0,0 +1,1055 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			clg.c
+ * @Description			Embeddable CPU load generation engine (libcpuloadgen)
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include "cpuloadgen.h"
+#include "clg.h"
+#include "clg_ops.h"
+#include "stats.h"
+#include "perfcnt.h"
+#include "verify.h"
+#include "trace.h"
+#include "histogram.h"
+#include "freqinv.h"
+#include "uclamp.h"
+#include "steal.h"
+#include "probes.h"
+#include "kernel.h"
+#include "idlegap.h"
+#include "wakeup.h"
+
+/* #define CPU_AFFINITY */
+
+/*
+ * Kernel iterations between two clock reads in period mode (a few us), and
+ * of a legacy controller busy slice, for a kernel iteration of
+ * CLG_ITERATION_NS. They are scaled to the same durations according to
+ * the actual kernel iteration time.
+ */
+#define WORKLOAD_CHUNK	250
+#define WORKLOAD_PWM	50000
+#define WORKLOAD_FULL	1000000
+
+/* Frame period of throughput targets without configured period (us) */
+#define RATE_PERIOD	10000
+
+/* Highest duty cycle of idle gap frames (busy slice 99x the gap) */
+#define CLG_GAP_MAX_LOAD	99.0
+
+/* Highest compensated load of legacy frames (frame = active * 100/(load+1)) */
+#define CLG_LEGACY_MAX_LOAD	99.0
+
+/* Load thread state, only written by the load thread but load */
+struct clg_thread {
+	struct clg_ctx *ctx;
+	const struct clg_ops *ops;
+	struct clg_ops native;	/* native ops, bound to this thread */
+	void *kstate;		/* kernel state */
+	unsigned int cpu;
+	int load;		/* target load, written by clg_set_load() */
+	int cur_load;		/* load applied to current frame */
+	uint64_t rate;		/* target iterations/s, if CLG_LOAD_RATE */
+	uint64_t cur_rate;	/* rate applied to current frame */
+	double rate_carry;	/* iterations not run yet (fractional) */
+	long int period;
+	unsigned int chunk, pwm, full;	/* WORKLOAD_* scaled to kernel */
+	int started;
+	pthread_t thread;
+	struct stats_slot *slot;
+	struct trace_ring *ring;
+	struct histogram *h_frame, *h_busy, *h_idle;
+	struct freqinv_cpu *freq;	/* NULL: no frequency compensation */
+	int freq_follow;	/* no counters: cpufreq of the run CPU */
+	struct uclamp_thread *uclamp;	/* NULL: no placement tracking */
+	struct steal_cpu *steal;	/* NULL: no steal compensation */
+	const struct idlegap *gap;	/* NULL: idle set by load and period */
+	unsigned int seed;		/* idle gap draws */
+	double gap_over_ns;		/* mean idle gap oversleep */
+	double warm_ns;		/* first chunk excess over steady chunks */
+	uint64_t warm_frames;	/* frames warm_ns was measured in */
+	struct stats_counters c;
+	uint64_t frame_start_ns;	/* period mode: nominal frame start */
+	struct stats_slot own_slot;	/* standalone threads only */
+};
+
+/* One PWM frame, as run by a controller */
+struct clg_frame {
+	uint64_t busy_start_ns;
+	uint64_t busy_end_ns;
+	uint64_t first_ns;	/* end of the first work chunk */
+	uint64_t idle_end_ns;
+	uint64_t frame_ns;	/* target frame length, 0: no target */
+	uint64_t busy_req_ns;	/* target busy slice */
+	uint64_t idle_req_ns;	/* requested idle time */
+	uint64_t iterations;
+};
+
+struct clg_ctx {
+	unsigned int count;
+	long int duration;
+	long int period;
+	const struct kernel *kernel;
+	const char *kparams;
+	double kscale;		/* CLG_ITERATION_NS / kernel iteration */
+	char kspec[KERNEL_SPEC_MAX];
+	struct idlegap gap;	/* count 0: no idle gap distribution */
+	int stop;
+	struct clg_thread *threads;
+};
+
+static int clg_running = 0;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		workload
+ * @BRIEF		run the selected kernel.
+ * @param[in]		priv: load thread
+ * @param[in]		iterations: number of kernel iterations
+ * @DESCRIPTION		run the selected kernel.
+ *//*------------------------------------------------------------------------ */
+static void workload(void *priv, unsigned int iterations)
+{
+	struct clg_thread *t = priv;
+
+	t->ctx->kernel->run(t->kstate, iterations);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		native_now
+ * @BRIEF		return monotonic time in nanoseconds.
+ * @RETURNS		CLOCK_MONOTONIC time, in ns
+ * @param[in]		priv: unused
+ * @DESCRIPTION		return monotonic time in nanoseconds.
+ *//*------------------------------------------------------------------------ */
+static uint64_t native_now(void *priv UNUSED)
+{
+	return now_ns();
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		native_sleep
+ * @BRIEF		sleep for a given time.
+ * @param[in]		priv: unused
+ * @param[in]		ns: sleep time (ns, rounded down to us)
+ * @DESCRIPTION		sleep for a given time.
+ *//*------------------------------------------------------------------------ */
+static void native_sleep(void *priv UNUSED, uint64_t ns)
+{
+	uint64_t us = ns / NSEC_PER_USEC;
+
+	/* Saturate rather than wrap very long requests */
+	usleep(us > UINT_MAX ? UINT_MAX : (unsigned int) us);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		native_sleep_until
+ * @BRIEF		sleep until a given monotonic time.
+ * @param[in]		priv: unused
+ * @param[in]		deadline_ns: CLOCK_MONOTONIC wakeup time, in ns
+ * @DESCRIPTION		sleep until a given monotonic time.
+ *//*------------------------------------------------------------------------ */
+static void native_sleep_until(void *priv UNUSED, uint64_t deadline_ns)
+{
+	struct timespec ts;
+
+	ts.tv_sec = deadline_ns / NSEC_PER_SEC;
+	ts.tv_nsec = deadline_ns % NSEC_PER_SEC;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+		EINTR)
+		;
+}
+
+
+const struct clg_ops clg_native_ops = {
+	native_now,
+	workload,
+	native_sleep,
+	native_sleep_until,
+	NULL};
+
+#define clg_now(t)		((t)->ops->now((t)->ops->priv))
+#define clg_work(t, n)		((t)->ops->work((t)->ops->priv, n))
+#define clg_sleep(t, ns)	((t)->ops->sleep((t)->ops->priv, ns))
+#define clg_sleep_until(t, ns)	((t)->ops->sleep_until((t)->ops->priv, ns))
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_busy_begin
+ * @BRIEF		start the busy slice of a frame.
+ * @param[in,out]	t: load thread
+ * @param[out]		f: frame
+ * @DESCRIPTION		start the busy slice of a frame.
+ *//*------------------------------------------------------------------------ */
+static inline void clg_busy_begin(struct clg_thread *t, struct clg_frame *f)
+{
+	stats_set_phase(t->slot, STATS_PHASE_BUSY);
+	f->busy_start_ns = clg_now(t);
+	trace_emit(t->ring, TRACE_FRAME_START, f->busy_start_ns, t->c.frames);
+	PROBE3(frame_start, t->cpu, t->c.frames, f->busy_start_ns);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_busy_end
+ * @BRIEF		end the busy slice of a frame.
+ * @param[in,out]	t: load thread
+ * @param[in]		f: frame (busy_end_ns and iterations set)
+ * @DESCRIPTION		end the busy slice of a frame.
+ *//*------------------------------------------------------------------------ */
+static inline void clg_busy_end(struct clg_thread *t,
+	const struct clg_frame *f)
+{
+	trace_emit(t->ring, TRACE_BUSY_END, f->busy_end_ns, f->iterations);
+	PROBE4(busy_end, t->cpu, t->c.frames,
+		f->busy_end_ns - f->busy_start_ns, f->iterations);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_frame_end
+ * @BRIEF		account a completed frame.
+ * @param[in,out]	t: load thread
+ * @param[in]		f: completed frame
+ * @DESCRIPTION		account a completed frame: publish counters, record
+ *			trace events and controller error histograms.
+ *//*------------------------------------------------------------------------ */
+static inline void clg_frame_end(struct clg_thread *t,
+	const struct clg_frame *f)
+{
+	uint64_t idle_ns = f->idle_end_ns - f->busy_end_ns;
+
+	if (f->frame_ns != 0) {
+		trace_emit(t->ring, TRACE_IDLE_END, f->idle_end_ns,
+			f->idle_req_ns);
+		PROBE4(idle_end, t->cpu, t->c.frames, idle_ns, f->idle_req_ns);
+	}
+	t->c.frames++;
+	t->c.busy_ns += f->busy_end_ns - f->busy_start_ns;
+	t->c.idle_ns += idle_ns;
+	if ((f->frame_ns != 0) && (idle_ns > f->idle_req_ns)) {
+		t->c.overshoot_ns += idle_ns - f->idle_req_ns;
+		trace_emit(t->ring, TRACE_OVERSHOOT, f->idle_end_ns,
+			idle_ns - f->idle_req_ns);
+	}
+	t->c.iterations += f->iterations;
+	if (t->uclamp != NULL)
+		uclamp_place(t->uclamp, f->busy_end_ns - f->busy_start_ns);
+	/* Plain stores to own slot */
+	stats_publish(t->slot, &t->c);
+
+	if (f->frame_ns == 0)
+		return;
+	hist_record(t->h_frame,
+		(int64_t) (f->idle_end_ns - f->busy_start_ns - f->frame_ns));
+	hist_record(t->h_busy, (int64_t) (f->busy_end_ns - f->busy_start_ns
+		- f->busy_req_ns));
+	hist_record(t->h_idle, (int64_t) (idle_ns - f->idle_req_ns));
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_effective_load
+ * @BRIEF		return the load to apply for a compensated load.
+ * @RETURNS		load to apply ([load-100])
+ * @param[in]		t: load thread
+ * @param[in]		load: target frequency-invariant, delivered load
+ * @DESCRIPTION		return the load to apply for a compensated load:
+ *			scaled by the maximum / current frequency ratio when
+ *			frequency compensation is enabled, so that busy time
+ *			times relative frequency matches the target, and by
+ *			the wall / delivered time ratio when steal
+ *			compensation is enabled, so that the CPU time the
+ *			hypervisor actually gives matches the target.
+ *//*------------------------------------------------------------------------ */
+static inline double clg_effective_load(const struct clg_thread *t, int load)
+{
+	double eff;
+
+	if ((t->freq == NULL) && (t->steal == NULL))
+		return load;
+	eff = load;
+	if (t->freq != NULL)
+		eff = eff * FREQINV_SCALE / freqinv_scale(t->freq);
+	if (t->steal != NULL)
+		eff = eff * STEAL_SCALE / steal_scale(t->steal);
+	return (eff > 100.0) ? 100.0 : eff;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_frame_full
+ * @BRIEF		run a 100% load frame.
+ * @param[in,out]	t: load thread
+ * @param[out]		f: frame
+ * @DESCRIPTION		run a 100% load frame (legacy controller).
+ *//*------------------------------------------------------------------------ */
+static void clg_frame_full(struct clg_thread *t, struct clg_frame *f)
+{
+	clg_busy_begin(t, f);
+	clg_work(t, t->full);
+	f->busy_end_ns = clg_now(t);
+	f->iterations = t->full;
+	clg_busy_end(t, f);
+	f->idle_end_ns = f->busy_end_ns;
+	f->frame_ns = 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_frame_legacy
+ * @BRIEF		run a frame with the legacy controller.
+ * @param[in,out]	t: load thread
+ * @param[out]		f: frame
+ * @param[in]		load: target load ([1-99])
+ * @DESCRIPTION		run a frame with the legacy controller: run a fixed
+ *			amount of work, then size idle time after it.
+ *//*------------------------------------------------------------------------ */
+static void clg_frame_legacy(struct clg_thread *t, struct clg_frame *f,
+	int load)
+{
+	uint64_t active_ns;
+	double eff;
+
+	/* Generate load (100%) */
+	clg_busy_begin(t, f);
+	clg_work(t, t->pwm);
+	f->busy_end_ns = clg_now(t);
+	f->iterations = t->pwm;
+	clg_busy_end(t, f);
+
+	/* Compute needed idle time */
+	active_ns = f->busy_end_ns - f->busy_start_ns;
+	eff = clg_effective_load(t, load);
+	if (eff > CLG_LEGACY_MAX_LOAD)
+		eff = CLG_LEGACY_MAX_LOAD;
+	f->frame_ns = (uint64_t) (active_ns * (100.0 / (eff + 1.0)));
+	f->busy_req_ns = (uint64_t) (f->frame_ns * eff / 100.0);
+	f->idle_req_ns = f->frame_ns > active_ns ? f->frame_ns - active_ns : 0;
+
+	/* Generate idle time */
+	stats_set_phase(t->slot, STATS_PHASE_IDLE);
+	clg_sleep(t, f->idle_req_ns);
+	f->idle_end_ns = clg_now(t);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_frame_idle
+ * @BRIEF		sleep until the end of a fixed-length frame.
+ * @param[in,out]	t: load thread
+ * @param[in,out]	f: frame (frame_ns and busy_end_ns set)
+ * @DESCRIPTION		sleep until the (absolute) end of a fixed-length
+ *			frame. A late wakeup shortens the next idle slice, so
+ *			that neither the duty cycle nor the frame rate drift;
+ *			resynchronize if more than a frame late.
+ *//*------------------------------------------------------------------------ */
+static void clg_frame_idle(struct clg_thread *t, struct clg_frame *f)
+{
+	t->frame_start_ns += f->frame_ns;
+	f->idle_req_ns = 0;
+	if (t->frame_start_ns > f->busy_end_ns) {
+		f->idle_req_ns = t->frame_start_ns - f->busy_end_ns;
+		stats_set_phase(t->slot, STATS_PHASE_IDLE);
+		clg_sleep_until(t, t->frame_start_ns);
+	}
+	f->idle_end_ns = clg_now(t);
+	if (f->idle_end_ns > t->frame_start_ns + f->frame_ns)
+		t->frame_start_ns = f->idle_end_ns;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_frame_period
+ * @BRIEF		run a fixed-length frame.
+ * @param[in,out]	t: load thread
+ * @param[out]		f: frame
+ * @param[in]		load: target load ([1-100])
+ * @DESCRIPTION		run a fixed-length frame: stay busy until load% of the
+ *			frame elapsed, then sleep until the frame end.
+ *//*------------------------------------------------------------------------ */
+static void clg_frame_period(struct clg_thread *t, struct clg_frame *f,
+	int load)
+{
+	f->frame_ns = (uint64_t) t->period * NSEC_PER_USEC;
+	f->busy_req_ns = (uint64_t) (f->frame_ns * clg_effective_load(t, load) /
+		100.0);
+
+	clg_busy_begin(t, f);
+	f->iterations = 0;
+	do {
+		clg_work(t, t->chunk);
+		f->iterations += t->chunk;
+		f->busy_end_ns = clg_now(t);
+		if (f->iterations == t->chunk)
+			f->first_ns = f->busy_end_ns;
+	} while (f->busy_end_ns - f->busy_start_ns < f->busy_req_ns);
+	clg_busy_end(t, f);
+
+	/*
+	 * Warm-up after the wakeup: the first chunk against the steady-state
+	 * chunk time of the rest of the same slice.
+	 */
+	if (f->iterations > t->chunk) {
+		t->warm_ns += (double) (f->first_ns - f->busy_start_ns) -
+			(double) (f->busy_end_ns - f->first_ns) * t->chunk /
+			(f->iterations - t->chunk);
+		t->warm_frames++;
+	}
+	clg_frame_idle(t, f);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_frame_gap
+ * @BRIEF		run a frame with a given idle gap length.
+ * @param[in,out]	t: load thread
+ * @param[out]		f: frame
+ * @param[in]		load: target load ([1-99])
+ * @DESCRIPTION		run a frame with an idle gap length drawn from the
+ *			configured distribution, then sleep for the gap. Gap
+ *			length is the controlled variable, so a late wakeup
+ *			lengthens the frame rather than the next gap being
+ *			shortened; it is accounted as overshoot, and the busy
+ *			slice is sized so that busy / (busy + mean actual
+ *			idle) matches load.
+ *//*------------------------------------------------------------------------ */
+static void clg_frame_gap(struct clg_thread *t, struct clg_frame *f, int load)
+{
+	double eff = clg_effective_load(t, load);
+	uint64_t idle_ns;
+
+	if (eff > CLG_GAP_MAX_LOAD)
+		eff = CLG_GAP_MAX_LOAD;
+	f->idle_req_ns = idlegap_draw(t->gap, &t->seed);
+	f->busy_req_ns = (uint64_t) ((f->idle_req_ns + t->gap_over_ns) *
+		eff / (100.0 - eff));
+	f->frame_ns = f->busy_req_ns + f->idle_req_ns;
+
+	clg_busy_begin(t, f);
+	f->iterations = 0;
+	do {
+		clg_work(t, t->chunk);
+		f->iterations += t->chunk;
+		f->busy_end_ns = clg_now(t);
+	} while (f->busy_end_ns - f->busy_start_ns < f->busy_req_ns);
+	clg_busy_end(t, f);
+
+	stats_set_phase(t->slot, STATS_PHASE_IDLE);
+	clg_sleep(t, f->idle_req_ns);
+	f->idle_end_ns = clg_now(t);
+	idle_ns = f->idle_end_ns - f->busy_end_ns;
+	if (idle_ns > f->idle_req_ns)
+		t->gap_over_ns += ((double) (idle_ns - f->idle_req_ns) -
+			t->gap_over_ns) / 8.0;
+	else
+		t->gap_over_ns -= t->gap_over_ns / 8.0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_frame_rate
+ * @BRIEF		run a fixed-length frame with a throughput target.
+ * @param[in,out]	t: load thread
+ * @param[out]		f: frame
+ * @param[in]		rate: target kernel iterations per second
+ * @DESCRIPTION		run a fixed-length frame with a throughput target:
+ *			run the frame's share of iterations, then sleep until
+ *			the frame end. The duty cycle follows the CPU speed;
+ *			if work does not fit in the frame, throughput falls
+ *			short of target (the CPU is saturated).
+ *//*------------------------------------------------------------------------ */
+static void clg_frame_rate(struct clg_thread *t, struct clg_frame *f,
+	uint64_t rate)
+{
+	uint64_t n;
+
+	f->frame_ns = (uint64_t) (t->period != 0 ? t->period : RATE_PERIOD) *
+		NSEC_PER_USEC;
+	t->rate_carry += (double) rate * f->frame_ns / NSEC_PER_SEC;
+	n = (t->rate_carry < UINT_MAX) ? (uint64_t) t->rate_carry : UINT_MAX;
+	t->rate_carry -= n;
+
+	clg_busy_begin(t, f);
+	if (n != 0)
+		clg_work(t, (unsigned int) n);
+	f->busy_end_ns = clg_now(t);
+	f->iterations = n;
+	/* No busy time target: the busy slice is whatever the work took */
+	f->busy_req_ns = f->busy_end_ns - f->busy_start_ns;
+	clg_busy_end(t, f);
+	clg_frame_idle(t, f);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_thread_frame
+ * @BRIEF		run one frame of a load thread.
+ * @param[in,out]	t: load thread
+ * @DESCRIPTION		run one frame of a load thread, with the controller
+ *			selected by configuration. Target load (or
+ *			throughput) is re-read every frame.
+ *//*------------------------------------------------------------------------ */
+void clg_thread_frame(struct clg_thread *t)
+{
+	struct freqinv_cpu *f_cpu;
+	struct steal_cpu *s;
+	struct clg_frame f;
+	uint64_t rate = 0;
+	int target, cpu;
+
+	target = __atomic_load_n(&t->load, __ATOMIC_ACQUIRE);
+	if (target == CLG_LOAD_RATE)
+		rate = __atomic_load_n(&t->rate, __ATOMIC_RELAXED);
+	if ((target != t->cur_load) || (rate != t->cur_rate)) {
+		t->cur_load = target;
+		t->cur_rate = rate;
+		__atomic_store_n(&t->slot->load, target, __ATOMIC_RELAXED);
+		trace_emit(t->ring, TRACE_RETARGET, clg_now(t),
+			target == CLG_LOAD_RATE ? rate : (uint64_t) target);
+	}
+	/* Follow the thread across CPUs (not pinned by default) */
+	cpu = sched_getcpu();
+	stats_set_cpu(t->slot, cpu);
+	if (t->steal != NULL) {
+		s = steal_get(cpu);
+		if (s != NULL)
+			t->steal = s;
+	}
+	if (t->freq_follow) {
+		f_cpu = freqinv_run_cpu(cpu);
+		if (f_cpu != NULL)
+			t->freq = f_cpu;
+	}
+
+	if (t->cur_load == CLG_LOAD_RATE)
+		clg_frame_rate(t, &f, t->cur_rate);
+	else if ((t->gap != NULL) && (t->cur_load != 100))
+		clg_frame_gap(t, &f, t->cur_load);
+	else if (t->period != 0)
+		clg_frame_period(t, &f, t->cur_load);
+	else if (t->cur_load != 100)
+		clg_frame_legacy(t, &f, t->cur_load);
+	else
+		clg_frame_full(t, &f);
+	clg_frame_end(t, &f);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_thread_run
+ * @BRIEF		Programmable CPU load generator
+ * @RETURNS		NULL
+ * @param[in]		ptr: load thread (struct clg_thread *)
+ * @DESCRIPTION		Programmable CPU load generator. Use simple deadloops
+ *			to generate load, and apply PWM (Pulse Width Modulation)
+ *			principle on it to make average CPU load vary between
+ *			0 and 100%.
+ *//*------------------------------------------------------------------------ */
+static void *clg_thread_run(void *ptr)
+{
+	struct clg_thread *t = ptr;
+	struct clg_ctx *ctx = t->ctx;
+	uint64_t start_ns, elapsed_ns;
+	int ret;
+#ifdef CPU_AFFINITY
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(t->cpu, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+#endif
+	/* Kernel state is allocated by the thread using it (first touch) */
+	if (ctx->kernel->init != NULL) {
+		t->kstate = ctx->kernel->init(ctx->kparams, &ret);
+		if (t->kstate == NULL) {
+			fprintf(stderr, "cpuloadgen: could not initialize CPU%u kernel! (%d)\n",
+				t->cpu, ret);
+			return NULL;
+		}
+	}
+	if (perfcnt_enabled())
+		perfcnt_thread_open(t->cpu);
+	verify_thread_register(t->cpu);
+	ret = trace_open(t->cpu);
+	if (ret == 0)
+		t->ring = trace_ring_get(t->cpu);
+	else if (ret != -EINVAL)
+		fprintf(stderr, "cpuloadgen: could not open CPU%u trace! (%d)\n",
+			t->cpu, ret);
+	t->h_frame = histogram_get(t->cpu, HIST_FRAME_ERROR);
+	t->h_busy = histogram_get(t->cpu, HIST_BUSY_ERROR);
+	t->h_idle = histogram_get(t->cpu, HIST_IDLE_OVERSLEEP);
+	t->uclamp = uclamp_get(t->cpu);
+	if (t->uclamp != NULL) {
+		ret = uclamp_thread_apply(t->cpu);
+		if (ret != 0)
+			fprintf(stderr, "cpuloadgen: could not set CPU%u utilization clamps! (%d)\n",
+				t->cpu, ret);
+	}
+	t->freq = freqinv_get(t->cpu);
+	if (t->freq != NULL)
+		t->freq_follow = (freqinv_thread_open(t->cpu) != 0);
+	t->steal = steal_get(t->cpu);
+	wakeup_thread_begin(t->cpu);
+
+	start_ns = clg_now(t);
+	t->frame_start_ns = start_ns;
+	PROBE3(thread_start, t->cpu, t->load, start_ns);
+
+	while (!__atomic_load_n(&ctx->stop, __ATOMIC_RELAXED)) {
+		clg_thread_frame(t);
+
+		elapsed_ns = clg_now(t) - start_ns;
+		PROBE4(frame_end, t->cpu, t->c.frames, t->cur_load, elapsed_ns);
+		if ((ctx->duration != 0) &&
+			(elapsed_ns >= (uint64_t) ctx->duration * NSEC_PER_SEC))
+			break;
+	}
+
+	wakeup_thread_end(t->cpu, &t->c, t->warm_ns, t->warm_frames);
+	verify_thread_unregister(t->cpu);
+	PROBE2(thread_stop, t->cpu, t->c.frames);
+	if (ctx->kernel->report != NULL)
+		ctx->kernel->report(t->kstate, t->cpu);
+	if (ctx->kernel->deinit != NULL)
+		ctx->kernel->deinit(t->kstate);
+
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_thread_new
+ * @BRIEF		create a standalone load thread state.
+ * @RETURNS		load thread state, NULL in case of error
+ * @param[in]		ops: time, sleep and work primitives
+ * @param[in]		load: target load ([1-100])
+ * @param[in]		period: PWM frame period in us, 0: legacy controller
+ * @DESCRIPTION		create a standalone load thread state, not attached
+ *			to an engine nor to telemetry, to be stepped one frame
+ *			at a time with clg_thread_frame() by the caller (e.g.
+ *			a simulator).
+ *//*------------------------------------------------------------------------ */
+struct clg_thread *clg_thread_new(const struct clg_ops *ops, int load,
+	long int period)
+{
+	struct clg_thread *t;
+
+	if ((ops == NULL) || (load < 1) || (load > 100) || (period < 0))
+		return NULL;
+	if (posix_memalign((void **) &t, STATS_CACHELINE_SIZE,
+		sizeof(struct clg_thread)) != 0)
+		return NULL;
+	memset(t, 0, sizeof(struct clg_thread));
+	t->ops = ops;
+	t->load = load;
+	t->cur_load = -1;
+	t->period = period;
+	t->chunk = WORKLOAD_CHUNK;
+	t->pwm = WORKLOAD_PWM;
+	t->full = WORKLOAD_FULL;
+	t->slot = &t->own_slot;
+	t->frame_start_ns = clg_now(t);
+
+	return t;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_thread_counters
+ * @BRIEF		return a standalone load thread counters.
+ * @param[in]		t: load thread
+ * @param[out]		c: counters
+ * @DESCRIPTION		return a standalone load thread counters.
+ *//*------------------------------------------------------------------------ */
+void clg_thread_counters(const struct clg_thread *t, struct clg_counters *c)
+{
+	c->load = t->cur_load;
+	c->frames = t->c.frames;
+	c->busy_ns = t->c.busy_ns;
+	c->idle_ns = t->c.idle_ns;
+	c->overshoot_ns = t->c.overshoot_ns;
+	c->iterations = t->c.iterations;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_thread_instrument
+ * @BRIEF		attach telemetry to a standalone load thread.
+ * @param[in,out]	t: load thread
+ * @param[in]		ring: trace ring (NULL: no trace)
+ * @param[in]		h_frame: frame error histogram (NULL: none)
+ * @param[in]		h_busy: busy slice error histogram (NULL: none)
+ * @param[in]		h_idle: idle oversleep histogram (NULL: none)
+ * @DESCRIPTION		attach telemetry to a standalone load thread, which
+ *			then records the same events as an engine thread.
+ *//*------------------------------------------------------------------------ */
+void clg_thread_instrument(struct clg_thread *t, struct trace_ring *ring,
+	struct histogram *h_frame, struct histogram *h_busy,
+	struct histogram *h_idle)
+{
+	t->ring = ring;
+	t->h_frame = h_frame;
+	t->h_busy = h_busy;
+	t->h_idle = h_idle;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_thread_compensate
+ * @BRIEF		attach load compensation to a standalone load thread.
+ * @param[in,out]	t: load thread
+ * @param[in]		freq: frequency scale (NULL: no frequency invariance)
+ * @param[in]		steal: delivered time share (NULL: no steal
+ *				compensation)
+ * @DESCRIPTION		attach load compensation to a standalone load thread,
+ *			whose controllers then scale the target load as an
+ *			engine thread's do with freqinv=1 or steal=1.
+ *//*------------------------------------------------------------------------ */
+void clg_thread_compensate(struct clg_thread *t, struct freqinv_cpu *freq,
+	struct steal_cpu *steal)
+{
+	t->freq = freq;
+	t->steal = steal;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_thread_free
+ * @BRIEF		free a standalone load thread state.
+ * @param[in,out]	t: load thread
+ * @DESCRIPTION		free a standalone load thread state.
+ *//*------------------------------------------------------------------------ */
+void clg_thread_free(struct clg_thread *t)
+{
+	free(t);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_scale
+ * @BRIEF		scale a legacy kernel iteration count to another kernel.
+ * @RETURNS		scaled iteration count (>= 1)
+ * @param[in]		iterations: legacy kernel iteration count
+ * @param[in]		scale: iteration time ratio
+ * @DESCRIPTION		scale a legacy kernel iteration count to another kernel.
+ *//*------------------------------------------------------------------------ */
+static unsigned int clg_scale(unsigned int iterations, double scale)
+{
+	double n = iterations * scale;
+
+	if (!(n >= 1.0))
+		return 1;
+	if (n > 1.0e9)
+		return 1000000000;
+	return (unsigned int) n;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_start
+ * @BRIEF		start load generation.
+ * @RETURNS		0 on success
+ *			-EINVAL in case of invalid configuration
+ *			-ENOTSUP if no variant of the kernel runs on this CPU
+ *			-EBUSY if an engine is already running
+ *			-ENOMEM in case of allocation failure
+ *			-errno in case of thread creation failure, or
+ *			error of the kernel init() (e.g. -ENOENT)
+ * @param[in]		cfg: engine configuration
+ * @param[out]		ctx: engine context
+ * @DESCRIPTION		start one load thread per CPU with a load assigned.
+ *			Telemetry modules enabled beforehand (perf counters,
+ *			verify, trace, histograms) are fed by load threads.
+ *//*------------------------------------------------------------------------ */
+int clg_start(const struct clg_config *cfg, struct clg_ctx **ctx)
+{
+	struct idlegap gap;
+	struct clg_ctx *c;
+	struct clg_thread *t;
+	unsigned int i;
+	int ret;
+
+	if ((cfg == NULL) || (ctx == NULL) || (cfg->cpu_count == 0) ||
+		(cfg->loads == NULL) || (cfg->duration < 0) ||
+		(cfg->period < 0))
+		return -EINVAL;
+	if ((cfg->idle != NULL) && (idlegap_parse(cfg->idle, &gap) != 0))
+		return -EINVAL;
+	for (i = 0; i < cfg->cpu_count; i++) {
+		if (cfg->loads[i] == CLG_LOAD_RATE) {
+			if ((cfg->rates == NULL) || !(cfg->rates[i] >= 1.0) ||
+				(cfg->rates[i] > CLG_RATE_MAX))
+				return -EINVAL;
+		} else if ((cfg->loads[i] != CLG_LOAD_NONE) &&
+			((cfg->loads[i] < 1) || (cfg->loads[i] > 100))) {
+			return -EINVAL;
+		}
+	}
+	if (clg_running)
+		return -EBUSY;
+
+	c = calloc(1, sizeof(struct clg_ctx));
+	if (c == NULL)
+		return -ENOMEM;
+	ret = kernel_find(cfg->kernel, &c->kernel, &c->kparams);
+	if (ret != 0) {
+		free(c);
+		return ret;
+	}
+	/* Keep kernel parameters, spec may not outlive this call */
+	kernel_spec(c->kernel, c->kparams, c->kspec, sizeof(c->kspec));
+	c->kparams = strchr(c->kspec, ':') != NULL ?
+		strchr(c->kspec, ':') + 1 : "";
+	c->kscale = CLG_ITERATION_NS /
+		kernel_iteration_ns(c->kernel, c->kparams, &ret);
+	if (ret != 0) {
+		/* Kernel state could not be initialized (e.g. parameters) */
+		free(c);
+		return ret;
+	}
+	if (posix_memalign((void **) &c->threads, STATS_CACHELINE_SIZE,
+		cfg->cpu_count * sizeof(struct clg_thread)) != 0)
+		c->threads = NULL;
+	if ((c->threads == NULL) || (stats_init(cfg->cpu_count) != 0)) {
+		free(c->threads);
+		free(c);
+		return -ENOMEM;
+	}
+	memset(c->threads, 0, cfg->cpu_count * sizeof(struct clg_thread));
+	c->count = cfg->cpu_count;
+	c->duration = cfg->duration;
+	c->period = cfg->period;
+	if (cfg->idle != NULL)
+		c->gap = gap;
+	clg_running = 1;
+
+	for (i = 0; i < c->count; i++) {
+		t = &c->threads[i];
+		t->ctx = c;
+		t->native = clg_native_ops;
+		t->native.priv = t;
+		t->ops = &t->native;
+		t->cpu = i;
+		t->load = cfg->loads[i];
+		if (t->load == CLG_LOAD_RATE)
+			t->rate = (uint64_t) cfg->rates[i];
+		t->cur_load = -1;
+		t->period = c->period;
+		t->chunk = clg_scale(WORKLOAD_CHUNK, c->kscale);
+		t->pwm = clg_scale(WORKLOAD_PWM, c->kscale);
+		t->full = clg_scale(WORKLOAD_FULL, c->kscale);
+		t->slot = stats_slot_get(i);
+		t->gap = (c->gap.count != 0) ? &c->gap : NULL;
+		t->seed = i + 1;
+		if (t->load == CLG_LOAD_NONE)
+			continue;
+		t->slot->load = t->load;
+		ret = pthread_create(&t->thread, NULL, clg_thread_run, t);
+		if (ret != 0) {
+			clg_stop(c);
+			return -ret;
+		}
+		t->started = 1;
+	}
+
+	*ctx = c;
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_set_load
+ * @BRIEF		change the target load of a CPU.
+ * @RETURNS		0 on success
+ *			-EINVAL in case of invalid argument or if no load
+ *			thread runs on that CPU
+ * @param[in,out]	ctx: engine context
+ * @param[in]		cpu: CPU core ID
+ * @param[in]		load: new target load ([1-100])
+ * @DESCRIPTION		change the target load of a CPU. The load thread
+ *			applies it from its next frame on, and records a
+ *			retarget trace event.
+ *//*------------------------------------------------------------------------ */
+int clg_set_load(struct clg_ctx *ctx, unsigned int cpu, int load)
+{
+	if ((ctx == NULL) || (cpu >= ctx->count) ||
+		(ctx->threads[cpu].load == CLG_LOAD_NONE) ||
+		(load < 1) || (load > 100))
+		return -EINVAL;
+
+	__atomic_store_n(&ctx->threads[cpu].load, load, __ATOMIC_RELAXED);
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_set_rate
+ * @BRIEF		change the target throughput of a CPU.
+ * @RETURNS		0 on success
+ *			-EINVAL in case of invalid argument or if no load
+ *			thread runs on that CPU
+ * @param[in,out]	ctx: engine context
+ * @param[in]		cpu: CPU core ID
+ * @param[in]		rate: new target throughput (kernel iterations/s,
+ *			[1-CLG_RATE_MAX])
+ * @DESCRIPTION		change the target throughput of a CPU (switching it to
+ *			throughput mode if it had a target load). The load
+ *			thread applies it from its next frame on.
+ *//*------------------------------------------------------------------------ */
+int clg_set_rate(struct clg_ctx *ctx, unsigned int cpu, double rate)
+{
+	if ((ctx == NULL) || (cpu >= ctx->count) ||
+		(ctx->threads[cpu].load == CLG_LOAD_NONE) ||
+		!(rate >= 1.0) || (rate > CLG_RATE_MAX))
+		return -EINVAL;
+
+	__atomic_store_n(&ctx->threads[cpu].rate, (uint64_t) rate,
+		__ATOMIC_RELAXED);
+	__atomic_store_n(&ctx->threads[cpu].load, CLG_LOAD_RATE,
+		__ATOMIC_RELEASE);
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_stats
+ * @BRIEF		return a consistent snapshot of a load thread counters.
+ * @RETURNS		0 on success
+ *			-EINVAL in case of invalid argument or if no load
+ *			thread runs on that CPU
+ * @param[in]		ctx: engine context
+ * @param[in]		cpu: CPU core ID
+ * @param[out]		st: counters snapshot
+ * @DESCRIPTION		return a consistent snapshot of a load thread
+ *			counters. Lock-free: never blocks the load thread.
+ *//*------------------------------------------------------------------------ */
+int clg_stats(struct clg_ctx *ctx, unsigned int cpu, struct clg_counters *st)
+{
+	struct stats_counters c;
+
+	if ((ctx == NULL) || (st == NULL) || (cpu >= ctx->count) ||
+		(ctx->threads[cpu].load == CLG_LOAD_NONE))
+		return -EINVAL;
+
+	stats_snapshot(cpu, &c);
+	st->load = __atomic_load_n(&ctx->threads[cpu].slot->load,
+		__ATOMIC_RELAXED);
+	st->frames = c.frames;
+	st->busy_ns = c.busy_ns;
+	st->idle_ns = c.idle_ns;
+	st->overshoot_ns = c.overshoot_ns;
+	st->iterations = c.iterations;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_kernel
+ * @BRIEF		return the kernel variant load threads run.
+ * @RETURNS		kernel spec selecting exactly that variant
+ *			("name:key=value,...")
+ * @param[in]		ctx: engine context
+ * @DESCRIPTION		return the kernel variant load threads run.
+ *//*------------------------------------------------------------------------ */
+const char *clg_kernel(const struct clg_ctx *ctx)
+{
+	return ctx->kspec;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_wait
+ * @BRIEF		wait for all load threads to complete.
+ * @param[in,out]	ctx: engine context
+ * @DESCRIPTION		wait for all load threads to complete (i.e. for the
+ *			configured duration to elapse). Statistics remain
+ *			available until clg_stop().
+ *//*------------------------------------------------------------------------ */
+void clg_wait(struct clg_ctx *ctx)
+{
+	unsigned int i;
+
+	if (ctx == NULL)
+		return;
+	for (i = 0; i < ctx->count; i++) {
+		if (!ctx->threads[i].started)
+			continue;
+		pthread_join(ctx->threads[i].thread, NULL);
+		ctx->threads[i].started = 0;
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		clg_stop
+ * @BRIEF		stop load generation and free engine context.
+ * @param[in,out]	ctx: engine context
+ * @DESCRIPTION		stop all load threads at their next frame boundary,
+ *			wait for them, and free engine context and statistics.
+ *			Samplers reading statistics (reporter, cpufreq,
+ *			metrics) must be stopped beforehand.
+ *//*------------------------------------------------------------------------ */
+void clg_stop(struct clg_ctx *ctx)
+{
+	if (ctx == NULL)
+		return;
+
+	__atomic_store_n(&ctx->stop, 1, __ATOMIC_RELAXED);
+	clg_wait(ctx);
+	stats_deinit();
+	free(ctx->threads);
+	free(ctx);
+	clg_running = 0;
+}
@@ -0,0 +1,105 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			clg.h
+ * @Description			Embeddable CPU load generation engine (libcpuloadgen)
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __CLG_H__
+#define __CLG_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Library entry points: everything else is built hidden, and localized */
+#define CLG_API		__attribute__((visibility("default")))
+
+/* No load thread on this CPU */
+#define CLG_LOAD_NONE		(-1)
+/* Load thread with a throughput target (see clg_config.rates) */
+#define CLG_LOAD_RATE		0
+#define CLG_RATE_MAX		1e12	/* kernel iterations/s */
+
+/* Engine configuration, copied by clg_start() */
+struct clg_config {
+	unsigned int cpu_count;	/* number of entries in loads */
+	const int *loads;	/* initial load per CPU ([1-100], CLG_LOAD_NONE
+				   or CLG_LOAD_RATE) */
+	long int duration;	/* in seconds, 0: until clg_stop() */
+	long int period;	/* PWM frame period in us, 0: legacy controller */
+	const char *kernel;	/* "name[:key=value,...]", NULL: default */
+	const double *rates;	/* kernel iterations/s per CPU, for CPUs with
+				   CLG_LOAD_RATE load (NULL if none) */
+	const char *idle;	/* idle gap distribution "us[:weight],...",
+				   NULL: set by load and period */
+};
+
+/* Counters of a load thread, all monotonically increasing but load */
+struct clg_counters {
+	int load;
+	uint64_t frames;
+	uint64_t busy_ns;
+	uint64_t idle_ns;
+	uint64_t overshoot_ns;
+	uint64_t iterations;
+};
+
+/* Opaque engine context */
+struct clg_ctx;
+
+/*
+ * Only one engine may run at a time in a process: the telemetry modules
+ * (stats, perf counters, traces, histograms...) it feeds are process-wide.
+ */
+CLG_API int clg_start(const struct clg_config *cfg, struct clg_ctx **ctx);
+CLG_API int clg_set_load(struct clg_ctx *ctx, unsigned int cpu, int load);
+CLG_API int clg_set_rate(struct clg_ctx *ctx, unsigned int cpu, double rate);
+CLG_API int clg_stats(struct clg_ctx *ctx, unsigned int cpu,
+	struct clg_counters *st);
+CLG_API const char *clg_kernel(const struct clg_ctx *ctx);
+CLG_API void clg_wait(struct clg_ctx *ctx);
+CLG_API void clg_stop(struct clg_ctx *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
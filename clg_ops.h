@@ -0,0 +1,90 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			clg_ops.h
+ * @Description			Load engine time, sleep and work primitives (internal)
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __CLG_OPS_H__
+#define __CLG_OPS_H__
+
+#include <stdint.h>
+#include "clg.h"
+
+/*
+ * Primitives the controllers are built upon. Native ones use the monotonic
+ * clock, the workload kernel and the kernel's sleep services; a simulator
+ * may replace them to run controllers deterministically on simulated time.
+ */
+struct clg_ops {
+	uint64_t (*now)(void *priv);		/* time, in ns */
+	void (*work)(void *priv, unsigned int iterations);
+	void (*sleep)(void *priv, uint64_t ns);	/* relative */
+	void (*sleep_until)(void *priv, uint64_t deadline_ns); /* absolute */
+	void *priv;
+};
+
+struct clg_thread;
+struct trace_ring;
+struct histogram;
+struct freqinv_cpu;
+struct steal_cpu;
+
+/*
+ * Nominal kernel iteration time: standalone threads run slices of as many
+ * iterations as engine threads running a kernel of that iteration time.
+ */
+#define CLG_ITERATION_NS	20.0
+
+/* Native ops: priv must be set to the load thread using them */
+extern const struct clg_ops clg_native_ops;
+
+/* Standalone load thread state, stepped one frame at a time by the caller */
+struct clg_thread *clg_thread_new(const struct clg_ops *ops, int load,
+	long int period);
+void clg_thread_frame(struct clg_thread *t);
+void clg_thread_instrument(struct clg_thread *t, struct trace_ring *ring,
+	struct histogram *h_frame, struct histogram *h_busy,
+	struct histogram *h_idle);
+void clg_thread_compensate(struct clg_thread *t, struct freqinv_cpu *freq,
+	struct steal_cpu *steal);
+void clg_thread_counters(const struct clg_thread *t, struct clg_counters *c);
+void clg_thread_free(struct clg_thread *t);
+
+
+#endif
@@ -0,0 +1,524 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			cpufreq.c
+ * @Description			cpufreq and cpuidle telemetry
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "cpuloadgen.h"
+#include "clg.h"
+#include "sysfs.h"
+#include "stats.h"
+#include "output.h"
+#include "cpufreq.h"
+
+
+/* Time spent at a given frequency, per PWM phase, for a (cpu, load) pair */
+struct freq_bin {
+	unsigned int cpu;
+	int load;
+	long long khz;
+	uint64_t ns[STATS_PHASES];
+};
+
+/* Idle state residency for a (cpu, load) pair */
+struct idle_bin {
+	unsigned int cpu;
+	int load;
+	unsigned int state;
+	uint64_t time_us;
+	uint64_t usage;
+};
+
+struct cpu_telemetry {
+	uint64_t seq;		/* sample idle counters were last read at */
+	unsigned int nstates;
+	char name[CPUIDLE_MAX_STATES][CPUIDLE_NAME_MAX];
+	long long usage[CPUIDLE_MAX_STATES];
+	long long time_us[CPUIDLE_MAX_STATES];
+};
+
+static struct cpu_telemetry *tel = NULL;
+static unsigned int tel_count = 0;
+static struct freq_bin *freq_bins = NULL;
+static unsigned int freq_bin_count = 0, freq_bin_size = 0;
+static struct idle_bin *idle_bins = NULL;
+static unsigned int idle_bin_count = 0, idle_bin_size = 0;
+
+/* Sampled time per (cpu, load), for residency percentages */
+static struct freq_bin *totals = NULL;
+static unsigned int total_count = 0, total_size = 0;
+
+static pthread_t sampler;
+static int sampler_running = 0;
+static int sampler_stop;
+static uint64_t sampler_period_ns;
+static uint64_t sampler_seq;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		bin_grow
+ * @BRIEF		make room for one more element in a bin array.
+ * @RETURNS		0 on success, -ENOMEM otherwise
+ * @param[in,out]	array: bin array
+ * @param[in]		count: number of elements in use
+ * @param[in,out]	size: number of elements allocated
+ * @param[in]		elt: element size
+ * @DESCRIPTION		make room for one more element in a bin array.
+ *//*------------------------------------------------------------------------ */
+static int bin_grow(void **array, unsigned int count, unsigned int *size,
+	size_t elt)
+{
+	void *p;
+
+	if (count < *size)
+		return 0;
+	p = realloc(*array, (*size + 64) * elt);
+	if (p == NULL)
+		return -ENOMEM;
+	*array = p;
+	*size += 64;
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freq_bin_get
+ * @BRIEF		find or create a frequency bin.
+ * @RETURNS		bin, NULL in case of allocation failure
+ * @param[in,out]	bins: bin array
+ * @param[in,out]	count: number of bins in use
+ * @param[in,out]	size: number of bins allocated
+ * @param[in]		cpu: CPU core ID
+ * @param[in]		load: target load
+ * @param[in]		khz: frequency
+ * @DESCRIPTION		find or create a frequency bin.
+ *//*------------------------------------------------------------------------ */
+static struct freq_bin *freq_bin_get(struct freq_bin **bins,
+	unsigned int *count, unsigned int *size,
+	unsigned int cpu, int load, long long khz)
+{
+	struct freq_bin *b;
+	unsigned int i;
+
+	for (i = 0; i < *count; i++) {
+		b = &(*bins)[i];
+		if ((b->cpu == cpu) && (b->load == load) && (b->khz == khz))
+			return b;
+	}
+	if (bin_grow((void **) bins, *count, size, sizeof(**bins)) != 0)
+		return NULL;
+	b = &(*bins)[(*count)++];
+	memset(b, 0, sizeof(*b));
+	b->cpu = cpu;
+	b->load = load;
+	b->khz = khz;
+	return b;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		idle_bin_get
+ * @BRIEF		find or create an idle state bin.
+ * @RETURNS		bin, NULL in case of allocation failure
+ * @param[in]		cpu: CPU core ID
+ * @param[in]		load: target load
+ * @param[in]		state: idle state index
+ * @DESCRIPTION		find or create an idle state bin.
+ *//*------------------------------------------------------------------------ */
+static struct idle_bin *idle_bin_get(unsigned int cpu, int load,
+	unsigned int state)
+{
+	struct idle_bin *b;
+	unsigned int i;
+
+	for (i = 0; i < idle_bin_count; i++) {
+		b = &idle_bins[i];
+		if ((b->cpu == cpu) && (b->load == load) && (b->state == state))
+			return b;
+	}
+	if (bin_grow((void **) &idle_bins, idle_bin_count, &idle_bin_size,
+		sizeof(*idle_bins)) != 0)
+		return NULL;
+	b = &idle_bins[idle_bin_count++];
+	memset(b, 0, sizeof(*b));
+	b->cpu = cpu;
+	b->load = load;
+	b->state = state;
+	return b;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpuidle_read
+ * @BRIEF		read usage and time of all idle states of a CPU.
+ * @param[in]		cpu: CPU core ID
+ * @param[out]		usage: per-state entry count
+ * @param[out]		time_us: per-state residency (us)
+ * @DESCRIPTION		read usage and time of all idle states of a CPU.
+ *//*------------------------------------------------------------------------ */
+static void cpuidle_read(unsigned int cpu, long long *usage, long long *time_us)
+{
+	char path[SYSFS_PATH_MAX];
+	unsigned int s;
+
+	for (s = 0; s < tel[cpu].nstates; s++) {
+		sysfs_path(path, sizeof(path),
+			SYSFS_CPU_PATH "/cpu%u/cpuidle/state%u/usage", cpu, s);
+		usage[s] = sysfs_read_ll(path);
+		sysfs_path(path, sizeof(path),
+			SYSFS_CPU_PATH "/cpu%u/cpuidle/state%u/time", cpu, s);
+		time_us[s] = sysfs_read_ll(path);
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpufreq_sample
+ * @BRIEF		take one telemetry sample of all loaded CPUs.
+ * @param[in]		dt: time elapsed since previous sample (in ns)
+ * @DESCRIPTION		take one telemetry sample of all loaded CPUs.
+ *			Load threads are not pinned: each one is sampled on
+ *			the CPU it last ran on. The elapsed time is credited
+ *			to that CPU's current frequency and to the PWM phase
+ *			the load thread is in; idle state counters deltas
+ *			are credited to the thread's target load, if the
+ *			CPU was also sampled the previous time (otherwise
+ *			they only become the new baseline).
+ *//*------------------------------------------------------------------------ */
+static void cpufreq_sample(uint64_t dt)
+{
+	long long usage[CPUIDLE_MAX_STATES], time_us[CPUIDLE_MAX_STATES];
+	struct cpu_telemetry *t;
+	struct freq_bin *fb;
+	struct idle_bin *ib;
+	char path[SYSFS_PATH_MAX];
+	unsigned int i, cpu, s;
+	long long khz;
+	int load, run;
+
+	sampler_seq++;
+	for (i = 0; i < tel_count; i++) {
+		load = __atomic_load_n(&stats_slot_get(i)->load,
+			__ATOMIC_RELAXED);
+		if (load == -1)
+			continue;
+		run = stats_cpu_get(i);
+		cpu = ((run >= 0) && ((unsigned int) run < tel_count)) ?
+			(unsigned int) run : i;
+		t = &tel[cpu];
+
+		sysfs_path(path, sizeof(path),
+			SYSFS_CPU_PATH "/cpu%u/cpufreq/scaling_cur_freq", cpu);
+		khz = sysfs_read_ll(path);
+		fb = freq_bin_get(&freq_bins, &freq_bin_count, &freq_bin_size,
+			cpu, load, khz);
+		if (fb != NULL)
+			fb->ns[stats_phase_get(i)] += dt;
+		fb = freq_bin_get(&totals, &total_count, &total_size,
+			cpu, load, 0);
+		if (fb != NULL)
+			fb->ns[0] += dt;
+
+		/* Another thread on this CPU was already credited */
+		if (t->seq == sampler_seq)
+			continue;
+		cpuidle_read(cpu, usage, time_us);
+		for (s = 0; (t->seq == sampler_seq - 1) && (s < t->nstates);
+			s++) {
+			if ((usage[s] < 0) || (t->usage[s] < 0))
+				continue;
+			ib = idle_bin_get(cpu, load, s);
+			if (ib == NULL)
+				continue;
+			ib->usage += usage[s] - t->usage[s];
+			ib->time_us += time_us[s] - t->time_us[s];
+		}
+		memcpy(t->usage, usage, sizeof(usage));
+		memcpy(t->time_us, time_us, sizeof(time_us));
+		t->seq = sampler_seq;
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpufreq_sampler
+ * @BRIEF		telemetry sampler thread.
+ * @param[in]		arg: unused
+ * @DESCRIPTION		telemetry sampler thread.
+ *//*------------------------------------------------------------------------ */
+static void *cpufreq_sampler(void *arg UNUSED)
+{
+	struct timespec ts;
+	uint64_t last, next, now;
+
+	last = next = now_ns();
+	while (!__atomic_load_n(&sampler_stop, __ATOMIC_ACQUIRE)) {
+		next += sampler_period_ns;
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		now = now_ns();
+		cpufreq_sample(now - last);
+		last = now;
+	}
+
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpufreq_start
+ * @BRIEF		start cpufreq and cpuidle telemetry.
+ * @RETURNS		0 on success
+ *			-ENOMEM in case of allocation failure
+ *			pthread error code otherwise
+ * @param[in]		count: number of CPU cores
+ * @param[in]		period_ms: sampling period (in ms)
+ * @DESCRIPTION		start cpufreq and cpuidle telemetry.
+ *			To be called once load threads are started.
+ *//*------------------------------------------------------------------------ */
+int cpufreq_start(unsigned int count, unsigned int period_ms)
+{
+	char path[SYSFS_PATH_MAX];
+	unsigned int cpu, s;
+	int ret;
+
+	tel = calloc(count, sizeof(struct cpu_telemetry));
+	if (tel == NULL)
+		return -ENOMEM;
+	tel_count = count;
+
+	for (cpu = 0; cpu < count; cpu++) {
+		for (s = 0; s < CPUIDLE_MAX_STATES; s++) {
+			sysfs_path(path, sizeof(path),
+				SYSFS_CPU_PATH "/cpu%u/cpuidle/state%u/name",
+				cpu, s);
+			if (sysfs_read_str(path, tel[cpu].name[s],
+				CPUIDLE_NAME_MAX) != 0)
+				break;
+		}
+		tel[cpu].nstates = s;
+		cpuidle_read(cpu, tel[cpu].usage, tel[cpu].time_us);
+	}
+
+	sampler_period_ns = (uint64_t) period_ms * 1000000ULL;
+	sampler_seq = 0;
+	sampler_stop = 0;
+	ret = pthread_create(&sampler, NULL, cpufreq_sampler, NULL);
+	if (ret != 0)
+		return ret;
+	sampler_running = 1;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpufreq_enabled
+ * @BRIEF		tell whether cpufreq telemetry is enabled.
+ * @RETURNS		1 if enabled, 0 otherwise
+ * @DESCRIPTION		tell whether cpufreq telemetry is enabled.
+ *//*------------------------------------------------------------------------ */
+int cpufreq_enabled(void)
+{
+	return tel != NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpufreq_stop
+ * @BRIEF		stop telemetry sampler thread.
+ * @DESCRIPTION		stop telemetry sampler thread.
+ *//*------------------------------------------------------------------------ */
+void cpufreq_stop(void)
+{
+	if (!sampler_running)
+		return;
+	__atomic_store_n(&sampler_stop, 1, __ATOMIC_RELEASE);
+	pthread_join(sampler, NULL);
+	sampler_running = 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpufreq_load_str
+ * @BRIEF		format the target of a load thread.
+ * @RETURNS		buf
+ * @param[in]		load: target load
+ * @param[out]		buf: string buffer
+ * @param[in]		size: string buffer size
+ * @DESCRIPTION		format the target of a load thread: load, or
+ *			throughput for CLG_LOAD_RATE threads.
+ *//*------------------------------------------------------------------------ */
+static const char *cpufreq_load_str(int load, char *buf, size_t size)
+{
+	if (load == CLG_LOAD_RATE)
+		snprintf(buf, size, "ops target");
+	else
+		snprintf(buf, size, "%3d%% load", load);
+	return buf;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpufreq_field_load
+ * @BRIEF		emit the target load field of a record.
+ * @param[in]		load: target load
+ * @DESCRIPTION		emit the target load field of a record, null for
+ *			CLG_LOAD_RATE threads.
+ *//*------------------------------------------------------------------------ */
+static void cpufreq_field_load(int load)
+{
+	if (load == CLG_LOAD_RATE)
+		output_field_null("load");
+	else
+		output_field_int("load", load);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpufreq_report
+ * @BRIEF		print and emit frequency and idle state residency.
+ * @DESCRIPTION		print and emit frequency and idle state residency,
+ *			per loaded CPU and target load (throughput targets
+ *			are binned apart, as "ops").
+ *			Must be called once the sampler is stopped.
+ *//*------------------------------------------------------------------------ */
+void cpufreq_report(void)
+{
+	struct freq_bin *tot, *fb;
+	struct idle_bin *ib;
+	double busy_khz, idle_khz, busy_ns, idle_ns, pct;
+	unsigned int i, j;
+	char lstr[16];
+
+	if (tel == NULL)
+		return;
+
+	for (i = 0; i < total_count; i++) {
+		tot = &totals[i];
+		if (tot->ns[0] == 0)
+			continue;
+		iprintf("\nCPU%u @ %s: frequency residency (busy / idle):\n",
+			tot->cpu,
+			cpufreq_load_str(tot->load, lstr, sizeof(lstr)));
+		busy_khz = idle_khz = busy_ns = idle_ns = 0.0;
+		for (j = 0; j < freq_bin_count; j++) {
+			fb = &freq_bins[j];
+			if ((fb->cpu != tot->cpu) || (fb->load != tot->load))
+				continue;
+			output_begin("freq_residency");
+			output_field_int("cpu", fb->cpu);
+			cpufreq_field_load(fb->load);
+			output_field_int("khz", fb->khz);
+			output_field_u64("busy_ns", fb->ns[STATS_PHASE_BUSY]);
+			output_field_u64("idle_ns", fb->ns[STATS_PHASE_IDLE]);
+			output_end();
+			if (fb->khz < 0) {
+				iprintf("\t     n/a: %5.1f%%\n", 100.0 *
+					(fb->ns[STATS_PHASE_BUSY] +
+					fb->ns[STATS_PHASE_IDLE]) / tot->ns[0]);
+				continue;
+			}
+			iprintf("\t%5lld MHz: %5.1f%% (%5.1f%% / %5.1f%%)\n",
+				fb->khz / 1000,
+				100.0 * (fb->ns[STATS_PHASE_BUSY] +
+				fb->ns[STATS_PHASE_IDLE]) / tot->ns[0],
+				100.0 * fb->ns[STATS_PHASE_BUSY] / tot->ns[0],
+				100.0 * fb->ns[STATS_PHASE_IDLE] / tot->ns[0]);
+			busy_khz += (double) fb->khz * fb->ns[STATS_PHASE_BUSY];
+			idle_khz += (double) fb->khz * fb->ns[STATS_PHASE_IDLE];
+			busy_ns += fb->ns[STATS_PHASE_BUSY];
+			idle_ns += fb->ns[STATS_PHASE_IDLE];
+		}
+		if (busy_ns + idle_ns > 0.0)
+			iprintf("\tmean: %.0f MHz busy, %.0f MHz idle\n",
+				busy_ns ? busy_khz / busy_ns / 1000.0 : 0.0,
+				idle_ns ? idle_khz / idle_ns / 1000.0 : 0.0);
+
+		if (tel[tot->cpu].nstates == 0)
+			continue;
+		iprintf("CPU%u @ %s: idle state residency:\n",
+			tot->cpu, lstr);
+		for (j = 0; j < idle_bin_count; j++) {
+			ib = &idle_bins[j];
+			if ((ib->cpu != tot->cpu) || (ib->load != tot->load))
+				continue;
+			output_begin("idle_residency");
+			output_field_int("cpu", ib->cpu);
+			cpufreq_field_load(ib->load);
+			output_field_int("state", ib->state);
+			output_field_str("name", tel[ib->cpu].name[ib->state]);
+			output_field_u64("time_us", ib->time_us);
+			output_field_u64("usage", ib->usage);
+			output_end();
+			pct = 100.0 * ib->time_us * 1.0e3 / tot->ns[0];
+			iprintf("\t%-8s: %5.1f%% (%8.1f entries/s)\n",
+				tel[ib->cpu].name[ib->state], pct,
+				ib->usage * 1.0e9 / tot->ns[0]);
+		}
+	}
+	fflush(output_info_stream());
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		cpufreq_deinit
+ * @BRIEF		stop telemetry and free its buffers.
+ * @DESCRIPTION		stop telemetry and free its buffers.
+ *//*------------------------------------------------------------------------ */
+void cpufreq_deinit(void)
+{
+	cpufreq_stop();
+	free(tel);
+	free(freq_bins);
+	free(idle_bins);
+	free(totals);
+	tel = NULL;
+	freq_bins = NULL;
+	idle_bins = NULL;
+	totals = NULL;
+	tel_count = freq_bin_count = freq_bin_size = 0;
+	idle_bin_count = idle_bin_size = total_count = total_size = 0;
+}
@@ -0,0 +1,436 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			freqinv.c
+ * @Description			Frequency-invariant load compensation
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "cpuloadgen.h"
+#include "output.h"
+#include "sysfs.h"
+#include "freqinv.h"
+
+
+static const char *freqinv_source_names[FREQINV_SRC_MAX] = {
+	"none",
+	"aperf/mperf",
+	"cpufreq"};
+
+static struct freqinv_cpu *freq_cpus = NULL;
+static unsigned int freq_count = 0;
+
+static pthread_t sampler;
+static int sampler_running = 0;
+static int sampler_stop;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_init
+ * @BRIEF		enable frequency-invariant load compensation.
+ * @RETURNS		0 on success, -ENOMEM otherwise
+ * @param[in]		count: number of CPU cores
+ * @DESCRIPTION		enable frequency-invariant load compensation: load
+ *			threads scale busy slices by the maximum / current
+ *			frequency ratio, so that the frequency-invariant
+ *			utilization (as tracked by the scheduler) matches the
+ *			requested load.
+ *//*------------------------------------------------------------------------ */
+int freqinv_init(unsigned int count)
+{
+	char path[SYSFS_PATH_MAX];
+	struct freqinv_cpu *f;
+	unsigned int cpu;
+
+	if (posix_memalign((void **) &freq_cpus, STATS_CACHELINE_SIZE,
+		count * sizeof(struct freqinv_cpu)) != 0) {
+		freq_cpus = NULL;
+		return -ENOMEM;
+	}
+	memset(freq_cpus, 0, count * sizeof(struct freqinv_cpu));
+	freq_count = count;
+
+	for (cpu = 0; cpu < count; cpu++) {
+		f = &freq_cpus[cpu];
+		f->scale = FREQINV_SCALE;
+		f->source = FREQINV_SRC_NONE;
+		f->fd_cycles = -1;
+		f->fd_ref = -1;
+		sysfs_path(path, sizeof(path),
+			SYSFS_CPU_PATH "/cpu%u/cpufreq/cpuinfo_max_freq", cpu);
+		f->max_khz = sysfs_read_ll(path);
+		/* ref-cycles tick at base (non-turbo) frequency */
+		sysfs_path(path, sizeof(path),
+			SYSFS_CPU_PATH "/cpu%u/cpufreq/base_frequency", cpu);
+		f->base_khz = sysfs_read_ll(path);
+		if (f->base_khz <= 0)
+			f->base_khz = f->max_khz;
+	}
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_enabled
+ * @BRIEF		tell whether load compensation is enabled.
+ * @RETURNS		1 if enabled, 0 otherwise
+ * @DESCRIPTION		tell whether load compensation is enabled.
+ *//*------------------------------------------------------------------------ */
+int freqinv_enabled(void)
+{
+	return freq_cpus != NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_get
+ * @BRIEF		return the frequency ratio of a CPU.
+ * @RETURNS		CPU frequency ratio, NULL if disabled
+ * @param[in]		cpu: CPU core ID
+ * @DESCRIPTION		return the frequency ratio of a CPU, to be read with
+ *			freqinv_scale().
+ *//*------------------------------------------------------------------------ */
+struct freqinv_cpu *freqinv_get(unsigned int cpu)
+{
+	if ((freq_cpus == NULL) || (cpu >= freq_count))
+		return NULL;
+	return &freq_cpus[cpu];
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_event_open
+ * @BRIEF		open a hardware counter on the calling thread.
+ * @RETURNS		file descriptor, -1 in case of error
+ * @param[in]		config: PERF_COUNT_HW_* event
+ * @param[in]		group_fd: group leader, -1 for a leader
+ * @DESCRIPTION		open a hardware counter on the calling thread,
+ *			user-space only if kernel events are not allowed.
+ *//*------------------------------------------------------------------------ */
+static int freqinv_event_open(uint64_t config, int group_fd)
+{
+	struct perf_event_attr attr;
+	int fd, exclude_kernel;
+
+	for (exclude_kernel = 0; exclude_kernel <= 1; exclude_kernel++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config;
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.exclude_kernel = exclude_kernel;
+		attr.exclude_hv = 1;
+		fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1,
+			group_fd, 0);
+		if ((fd >= 0) || (errno != EACCES))
+			return fd;
+	}
+
+	return -1;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_thread_open
+ * @BRIEF		open the frequency counters of the calling thread.
+ * @RETURNS		0 on success
+ *			-EINVAL in case of invalid cpu
+ *			-ENODEV if counters are not available
+ * @param[in]		cpu: CPU core ID the calling thread loads
+ * @DESCRIPTION		open the frequency counters of the calling thread:
+ *			core cycles and reference cycles (APERF and MPERF on
+ *			x86), whose ratio is the average frequency of the
+ *			thread while it runs. To be called by each load
+ *			thread before entering its loop. Without them
+ *			(e.g. in a VM), the scaling_cur_freq of the CPU the
+ *			thread runs on is used instead (freqinv_run_cpu()).
+ *			Either way, only CPUs of load threads are sampled.
+ *//*------------------------------------------------------------------------ */
+int freqinv_thread_open(unsigned int cpu)
+{
+	struct freqinv_cpu *f;
+	int fd_cycles, fd_ref;
+
+	f = freqinv_get(cpu);
+	if (f == NULL)
+		return -EINVAL;
+	if (f->base_khz <= 0)
+		return -ENODEV;
+
+	fd_cycles = freqinv_event_open(PERF_COUNT_HW_CPU_CYCLES, -1);
+	if (fd_cycles < 0)
+		return -ENODEV;
+	fd_ref = freqinv_event_open(PERF_COUNT_HW_REF_CPU_CYCLES, fd_cycles);
+	if (fd_ref < 0) {
+		close(fd_cycles);
+		return -ENODEV;
+	}
+	__atomic_store_n(&f->fd_ref, fd_ref, __ATOMIC_RELAXED);
+	__atomic_store_n(&f->fd_cycles, fd_cycles, __ATOMIC_RELEASE);
+	__atomic_store_n(&f->loaded, 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_run_cpu
+ * @BRIEF		return the cpufreq ratio of the CPU a thread runs on.
+ * @RETURNS		CPU frequency ratio, NULL if disabled or invalid cpu
+ * @param[in]		cpu: CPU core ID the calling thread runs on
+ *			(sched_getcpu())
+ * @DESCRIPTION		return the cpufreq ratio of the CPU a thread runs
+ *			on, for load threads without frequency counters:
+ *			load threads are not pinned, so they look it up once
+ *			per frame. The CPU is sampled from then on.
+ *//*------------------------------------------------------------------------ */
+struct freqinv_cpu *freqinv_run_cpu(int cpu)
+{
+	struct freqinv_cpu *f;
+
+	if (cpu < 0)
+		return NULL;
+	f = freqinv_get(cpu);
+	if ((f != NULL) && !__atomic_load_n(&f->loaded, __ATOMIC_RELAXED))
+		__atomic_store_n(&f->loaded, 1, __ATOMIC_RELEASE);
+
+	return f;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_sample
+ * @BRIEF		update the frequency ratio of a CPU.
+ * @param[in,out]	f: CPU frequency ratio
+ * @param[in]		cpu: CPU core ID
+ * @DESCRIPTION		update the frequency ratio of a CPU, from its load
+ *			thread counters if available (only when it ran long
+ *			enough in the period), from cpufreq otherwise.
+ *//*------------------------------------------------------------------------ */
+static void freqinv_sample(struct freqinv_cpu *f, unsigned int cpu)
+{
+	char path[SYSFS_PATH_MAX];
+	struct {
+		uint64_t nr;
+		uint64_t values[2];
+	} grp;
+	uint64_t dc, dr;
+	long long khz;
+	double ratio;
+	int fd;
+
+	fd = __atomic_load_n(&f->fd_cycles, __ATOMIC_ACQUIRE);
+	if (fd >= 0) {
+		if ((read(fd, &grp, sizeof(grp)) != (ssize_t) sizeof(grp)) ||
+			(grp.nr != 2))
+			return;
+		dc = grp.values[0] - f->last_cycles;
+		dr = grp.values[1] - f->last_ref;
+		if (dr < FREQINV_MIN_REF)
+			return;
+		f->last_cycles = grp.values[0];
+		f->last_ref = grp.values[1];
+		ratio = (double) dc / dr * f->base_khz / f->max_khz;
+		f->source = FREQINV_SRC_APERF;
+	} else if (f->max_khz > 0) {
+		sysfs_path(path, sizeof(path),
+			SYSFS_CPU_PATH "/cpu%u/cpufreq/scaling_cur_freq", cpu);
+		khz = sysfs_read_ll(path);
+		if (khz <= 0)
+			return;
+		ratio = (double) khz / f->max_khz;
+		f->source = FREQINV_SRC_CPUFREQ;
+	} else {
+		return;
+	}
+
+	/* Turbo frequencies above cpuinfo_max_freq count as maximum */
+	if (ratio > 1.0)
+		ratio = 1.0;
+	if (ratio < (double) FREQINV_SCALE_MIN / FREQINV_SCALE)
+		ratio = (double) FREQINV_SCALE_MIN / FREQINV_SCALE;
+	__atomic_store_n(&f->scale, (uint32_t) (ratio * FREQINV_SCALE),
+		__ATOMIC_RELAXED);
+	f->scale_sum += ratio;
+	f->samples++;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_sampler
+ * @BRIEF		frequency sampler thread.
+ * @param[in]		arg: unused
+ * @DESCRIPTION		frequency sampler thread: update all CPUs frequency
+ *			ratio every FREQINV_PERIOD_MS.
+ *//*------------------------------------------------------------------------ */
+static void *freqinv_sampler(void *arg UNUSED)
+{
+	struct timespec ts;
+	uint64_t next;
+	unsigned int cpu;
+
+	next = now_ns();
+	while (!__atomic_load_n(&sampler_stop, __ATOMIC_ACQUIRE)) {
+		for (cpu = 0; cpu < freq_count; cpu++)
+			if (__atomic_load_n(&freq_cpus[cpu].loaded,
+				__ATOMIC_ACQUIRE))
+				freqinv_sample(&freq_cpus[cpu], cpu);
+		next += FREQINV_PERIOD_MS * 1000000ULL;
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	}
+
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_start
+ * @BRIEF		start the frequency sampler thread.
+ * @RETURNS		0 on success, pthread error code otherwise
+ * @DESCRIPTION		start the frequency sampler thread.
+ *			To be called once load threads are started.
+ *//*------------------------------------------------------------------------ */
+int freqinv_start(void)
+{
+	int ret;
+
+	if (freq_cpus == NULL)
+		return 0;
+	sampler_stop = 0;
+	ret = pthread_create(&sampler, NULL, freqinv_sampler, NULL);
+	if (ret != 0)
+		return ret;
+	sampler_running = 1;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_stop
+ * @BRIEF		stop the frequency sampler thread.
+ * @DESCRIPTION		stop the frequency sampler thread.
+ *//*------------------------------------------------------------------------ */
+void freqinv_stop(void)
+{
+	if (!sampler_running)
+		return;
+	__atomic_store_n(&sampler_stop, 1, __ATOMIC_RELEASE);
+	pthread_join(sampler, NULL);
+	sampler_running = 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_report
+ * @BRIEF		print and emit frequency ratio per CPU.
+ * @DESCRIPTION		print and emit the frequency source and the mean
+ *			frequency ratio busy slices were compensated for, per
+ *			loaded CPU. Must be called once the sampler is
+ *			stopped.
+ *//*------------------------------------------------------------------------ */
+void freqinv_report(void)
+{
+	struct freqinv_cpu *f;
+	unsigned int cpu;
+	double mean;
+
+	if (freq_cpus == NULL)
+		return;
+
+	iprintf("\nFrequency invariance (busy slices scaled by max / current frequency):\n");
+	for (cpu = 0; cpu < freq_count; cpu++) {
+		f = &freq_cpus[cpu];
+		if (!f->loaded)
+			continue;
+		mean = f->samples ? f->scale_sum / f->samples : 1.0;
+		iprintf("\tCPU%u: source %-11s max %7lld kHz, mean frequency %5.1f%% of max\n",
+			cpu, freqinv_source_names[f->source], f->max_khz,
+			mean * 100.0);
+
+		output_begin("freqinv");
+		output_field_int("cpu", cpu);
+		output_field_str("source", freqinv_source_names[f->source]);
+		output_field_int("max_khz", f->max_khz);
+		output_field_int("base_khz", f->base_khz);
+		output_field_u64("samples", f->samples);
+		output_field_double("mean_ratio", mean);
+		output_end();
+	}
+	for (cpu = 0; cpu < freq_count; cpu++)
+		if (freq_cpus[cpu].loaded &&
+			(freq_cpus[cpu].source == FREQINV_SRC_NONE))
+			break;
+	if (cpu != freq_count)
+		iprintf("\tNo frequency information on some CPUs: load was not compensated there.\n");
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_deinit
+ * @BRIEF		close counters and free buffers.
+ * @DESCRIPTION		close counters and free buffers.
+ *			Must not be called while load threads are running.
+ *//*------------------------------------------------------------------------ */
+void freqinv_deinit(void)
+{
+	unsigned int cpu;
+
+	if (freq_cpus == NULL)
+		return;
+	for (cpu = 0; cpu < freq_count; cpu++) {
+		if (freq_cpus[cpu].fd_ref >= 0)
+			close(freq_cpus[cpu].fd_ref);
+		if (freq_cpus[cpu].fd_cycles >= 0)
+			close(freq_cpus[cpu].fd_cycles);
+	}
+	free(freq_cpus);
+	freq_cpus = NULL;
+	freq_count = 0;
+}
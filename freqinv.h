@@ -0,0 +1,109 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			freqinv.h
+ * @Description			Frequency-invariant load compensation
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __FREQINV_H__
+#define __FREQINV_H__
+
+#include <stdint.h>
+#include "stats.h"
+
+/* Current / maximum frequency ratio, fixed point (as SCHED_CAPACITY_SCALE) */
+#define FREQINV_SCALE		1024
+#define FREQINV_SCALE_MIN	(FREQINV_SCALE / 16)
+#define FREQINV_PERIOD_MS	10
+/* Minimum reference cycles in a sampling period to update the ratio */
+#define FREQINV_MIN_REF		100000
+
+typedef enum {
+	FREQINV_SRC_NONE,	/* no frequency information: no compensation */
+	FREQINV_SRC_APERF,	/* cycles / ref-cycles of the load thread */
+	FREQINV_SRC_CPUFREQ,	/* scaling_cur_freq / cpuinfo_max_freq */
+	FREQINV_SRC_MAX
+} freqinv_source;
+
+/*
+ * Per-CPU frequency ratio, written by the sampler thread and read by the
+ * load thread once per frame. With counters, it is the ratio of the load
+ * thread of that slot; otherwise, the cpufreq ratio of that physical CPU.
+ */
+struct freqinv_cpu {
+	uint32_t scale;		/* FREQINV_SCALE at maximum frequency */
+	int source;
+	int loaded;		/* counters opened, or a load thread ran here */
+	int fd_cycles;		/* group leader, -1 if not opened */
+	int fd_ref;
+	uint64_t last_cycles;
+	uint64_t last_ref;
+	long long max_khz;
+	long long base_khz;	/* ref-cycles frequency */
+	double scale_sum;
+	uint64_t samples;
+} __attribute__((aligned(STATS_CACHELINE_SIZE)));
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		freqinv_scale
+ * @BRIEF		return the current frequency ratio of a CPU.
+ * @RETURNS		current / maximum frequency (FREQINV_SCALE: maximum)
+ * @param[in]		f: CPU frequency ratio (NULL: disabled)
+ * @DESCRIPTION		return the current frequency ratio of a CPU.
+ *//*------------------------------------------------------------------------ */
+static inline uint32_t freqinv_scale(const struct freqinv_cpu *f)
+{
+	if (f == NULL)
+		return FREQINV_SCALE;
+	return __atomic_load_n(&f->scale, __ATOMIC_RELAXED);
+}
+
+
+int freqinv_init(unsigned int count);
+int freqinv_enabled(void);
+struct freqinv_cpu *freqinv_get(unsigned int cpu);
+int freqinv_thread_open(unsigned int cpu);
+struct freqinv_cpu *freqinv_run_cpu(int cpu);
+int freqinv_start(void);
+void freqinv_stop(void);
+void freqinv_report(void);
+void freqinv_deinit(void);
+
+
+#endif
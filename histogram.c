@@ -0,0 +1,297 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			histogram.c
+ * @Description			Fixed-size log-linear histograms of controller errors
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "cpuloadgen.h"
+#include "stats.h"
+#include "output.h"
+#include "histogram.h"
+
+
+static const char *hist_names[HIST_KIND_MAX] = {
+	"frame_error",
+	"busy_error",
+	"idle_oversleep"};
+
+static struct histogram *hists = NULL;
+static unsigned int hist_count = 0;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		histogram_init
+ * @BRIEF		allocate per-thread controller error histograms.
+ * @RETURNS		0 on success
+ *			-ENOMEM in case of allocation failure
+ * @param[in]		count: number of CPU cores
+ * @DESCRIPTION		allocate per-thread controller error histograms.
+ *			Memory is fixed: HIST_KIND_MAX histograms per CPU.
+ *//*------------------------------------------------------------------------ */
+int histogram_init(unsigned int count)
+{
+	hists = calloc(count * HIST_KIND_MAX, sizeof(struct histogram));
+	if (hists == NULL)
+		return -ENOMEM;
+	hist_count = count;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		histogram_enabled
+ * @BRIEF		tell whether histograms are recorded.
+ * @RETURNS		1 if histograms are recorded, 0 otherwise
+ * @DESCRIPTION		tell whether histograms are recorded.
+ *//*------------------------------------------------------------------------ */
+int histogram_enabled(void)
+{
+	return hists != NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		histogram_get
+ * @BRIEF		return a thread's histogram.
+ * @RETURNS		histogram, NULL if histograms are disabled
+ * @param[in]		cpu: CPU core ID
+ * @param[in]		kind: histogram kind
+ * @DESCRIPTION		return a thread's histogram. Only the load thread of
+ *			that CPU may record into it.
+ *//*------------------------------------------------------------------------ */
+struct histogram *histogram_get(unsigned int cpu, hist_kind kind)
+{
+	if ((hists == NULL) || (cpu >= hist_count) || (kind >= HIST_KIND_MAX))
+		return NULL;
+	return &hists[cpu * HIST_KIND_MAX + kind];
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		hist_value
+ * @BRIEF		return the representative magnitude of a bucket.
+ * @RETURNS		bucket middle value (ns)
+ * @param[in]		idx: bucket index
+ * @DESCRIPTION		return the representative magnitude of a bucket.
+ *//*------------------------------------------------------------------------ */
+static uint64_t hist_value(unsigned int idx)
+{
+	unsigned int shift;
+
+	if (idx < HIST_SUB)
+		return idx;
+	shift = idx / HIST_SUB - 1;
+	return (((uint64_t) HIST_SUB + idx % HIST_SUB) << shift) +
+		((1ULL << shift) >> 1);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		histogram_percentile
+ * @BRIEF		return a percentile of a histogram.
+ * @RETURNS		percentile value (ns), 0 if histogram is empty
+ * @param[in]		h: histogram
+ * @param[in]		p: percentile ([0-100])
+ * @DESCRIPTION		return a percentile of a histogram, with the bucket
+ *			resolution, clamped to the recorded min and max.
+ *//*------------------------------------------------------------------------ */
+int64_t histogram_percentile(const struct histogram *h, double p)
+{
+	uint64_t rank, n = 0;
+	int64_t v = 0;
+	int i;
+
+	if (h->count == 0)
+		return 0;
+	rank = (uint64_t) ceil(p / 100.0 * h->count);
+	if (rank < 1)
+		rank = 1;
+
+	for (i = HIST_BUCKETS - 1; i >= 0; i--) {
+		n += h->neg[i];
+		if (n >= rank) {
+			v = -(int64_t) hist_value(i);
+			goto found;
+		}
+	}
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		n += h->pos[i];
+		if (n >= rank) {
+			v = (int64_t) hist_value(i);
+			goto found;
+		}
+	}
+	return h->max;
+
+found:
+	if (v < h->min)
+		return h->min;
+	if (v > h->max)
+		return h->max;
+	return v;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		hist_merge
+ * @BRIEF		merge a histogram into another one.
+ * @param[in,out]	dst: destination histogram
+ * @param[in]		src: histogram to be merged
+ * @DESCRIPTION		merge a histogram into another one.
+ *//*------------------------------------------------------------------------ */
+static void hist_merge(struct histogram *dst, const struct histogram *src)
+{
+	unsigned int i;
+
+	if (src->count == 0)
+		return;
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		dst->neg[i] += src->neg[i];
+		dst->pos[i] += src->pos[i];
+	}
+	if ((dst->count == 0) || (src->min < dst->min))
+		dst->min = src->min;
+	if ((dst->count == 0) || (src->max > dst->max))
+		dst->max = src->max;
+	dst->count += src->count;
+	dst->sum += src->sum;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		hist_print
+ * @BRIEF		print and emit percentiles of a histogram.
+ * @param[in]		kind: histogram kind
+ * @param[in]		cpu: CPU core ID, -1 for all CPUs
+ * @param[in]		load: target load, -1 for all CPUs
+ * @param[in]		h: histogram
+ * @DESCRIPTION		print and emit percentiles of a histogram.
+ *//*------------------------------------------------------------------------ */
+static void hist_print(hist_kind kind, int cpu, int load,
+	const struct histogram *h)
+{
+	static const double pct[] = {50.0, 90.0, 99.0, 99.9};
+	static const char *pct_names[] = {"p50_ns", "p90_ns", "p99_ns",
+		"p999_ns"};
+	int64_t p[4];
+	char name[16];
+	unsigned int i;
+
+	for (i = 0; i < 4; i++)
+		p[i] = histogram_percentile(h, pct[i]);
+
+	if (cpu < 0)
+		snprintf(name, sizeof(name), "all");
+	else
+		snprintf(name, sizeof(name), "CPU%d", cpu);
+	iprintf("\t%-14s %-6s %9llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+		hist_names[kind], name, (unsigned long long) h->count,
+		h->min / 1.0e3, h->sum / h->count / 1.0e3, p[0] / 1.0e3,
+		p[1] / 1.0e3, p[2] / 1.0e3, p[3] / 1.0e3, h->max / 1.0e3);
+
+	output_begin("histogram");
+	output_field_str("kind", hist_names[kind]);
+	output_field_int("cpu", cpu);
+	output_field_int("load", load);
+	output_field_u64("count", h->count);
+	output_field_int("min_ns", h->min);
+	output_field_double("mean_ns", h->sum / h->count);
+	for (i = 0; i < 4; i++)
+		output_field_int(pct_names[i], p[i]);
+	output_field_int("max_ns", h->max);
+	output_end();
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		histogram_report
+ * @BRIEF		merge and print controller error percentiles.
+ * @DESCRIPTION		print per-thread controller error percentiles, and
+ *			percentiles of all threads merged.
+ *			Must be called once load threads are stopped.
+ *//*------------------------------------------------------------------------ */
+void histogram_report(void)
+{
+	struct histogram *all;
+	unsigned int cpu;
+	int k;
+
+	if (hists == NULL)
+		return;
+	all = calloc(1, sizeof(struct histogram));
+	if (all == NULL)
+		return;
+
+	iprintf("\nController accuracy (us):\n");
+	iprintf("\t%-14s %-6s %9s %9s %9s %9s %9s %9s %9s %9s\n",
+		"", "", "frames", "min", "mean", "p50", "p90", "p99", "p99.9",
+		"max");
+	for (k = 0; k < HIST_KIND_MAX; k++) {
+		memset(all, 0, sizeof(struct histogram));
+		for (cpu = 0; cpu < hist_count; cpu++) {
+			const struct histogram *h = histogram_get(cpu, k);
+
+			if (h->count == 0)
+				continue;
+			hist_print(k, cpu, stats_slot_get(cpu)->load, h);
+			hist_merge(all, h);
+		}
+		if (all->count != 0)
+			hist_print(k, -1, -1, all);
+	}
+	free(all);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		histogram_deinit
+ * @BRIEF		free histograms.
+ * @DESCRIPTION		free histograms.
+ *//*------------------------------------------------------------------------ */
+void histogram_deinit(void)
+{
+	free(hists);
+	hists = NULL;
+	hist_count = 0;
+}
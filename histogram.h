@@ -0,0 +1,130 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			histogram.h
+ * @Description			Fixed-size log-linear histograms of controller errors
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <stdint.h>
+
+/*
+ * Log-linear bucketing: values below 2^HIST_SUB_BITS ns get one bucket each,
+ * larger values get 2^HIST_SUB_BITS buckets per power of 2 (~3% relative
+ * error). Magnitudes are clamped to 2^HIST_MAX_BITS ns (~18 minutes).
+ * Signed values use a mirrored set of buckets for negative values.
+ */
+#define HIST_SUB_BITS		5
+#define HIST_SUB		(1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS		40
+#define HIST_BUCKETS		((HIST_MAX_BITS - HIST_SUB_BITS + 2) * HIST_SUB)
+
+typedef enum {
+	HIST_FRAME_ERROR,	/* frame length - target frame length */
+	HIST_BUSY_ERROR,	/* busy slice - target busy slice */
+	HIST_IDLE_OVERSLEEP,	/* idle slice - requested idle time */
+	HIST_KIND_MAX
+} hist_kind;
+
+struct histogram {
+	uint64_t count;
+	int64_t min;
+	int64_t max;
+	double sum;
+	uint64_t neg[HIST_BUCKETS];
+	uint64_t pos[HIST_BUCKETS];
+};
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		hist_index
+ * @BRIEF		return the bucket index of a magnitude.
+ * @RETURNS		bucket index, in [0 .. HIST_BUCKETS - 1]
+ * @param[in]		m: magnitude (ns)
+ * @DESCRIPTION		return the bucket index of a magnitude.
+ *//*------------------------------------------------------------------------ */
+static inline unsigned int hist_index(uint64_t m)
+{
+	unsigned int e;
+
+	if (m < HIST_SUB)
+		return (unsigned int) m;
+	if (m >= (1ULL << HIST_MAX_BITS))
+		m = (1ULL << HIST_MAX_BITS) - 1;
+	e = 63 - __builtin_clzll(m);
+	return (e - HIST_SUB_BITS + 1) * HIST_SUB +
+		((m >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		hist_record
+ * @BRIEF		record a value into a histogram.
+ * @param[in,out]	h: histogram owned by the calling thread (NULL: no-op)
+ * @param[in]		v: value (ns)
+ * @DESCRIPTION		record a value into a histogram. Constant time, no
+ *			allocation, no lock.
+ *//*------------------------------------------------------------------------ */
+static inline void hist_record(struct histogram *h, int64_t v)
+{
+	if (h == NULL)
+		return;
+	if (v < 0)
+		h->neg[hist_index(-(uint64_t) v)]++;
+	else
+		h->pos[hist_index(v)]++;
+	if ((h->count == 0) || (v < h->min))
+		h->min = v;
+	if ((h->count == 0) || (v > h->max))
+		h->max = v;
+	h->count++;
+	h->sum += (double) v;
+}
+
+
+int histogram_init(unsigned int count);
+int histogram_enabled(void);
+struct histogram *histogram_get(unsigned int cpu, hist_kind kind);
+int64_t histogram_percentile(const struct histogram *h, double p);
+void histogram_report(void);
+void histogram_deinit(void);
+
+
+#endif
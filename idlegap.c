@@ -0,0 +1,121 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			idlegap.c
+ * @Description			Idle gap length distributions
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "cpuloadgen.h"
+#include "idlegap.h"
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		idlegap_parse
+ * @BRIEF		parse an idle gap distribution.
+ * @RETURNS		0 on success, -EINVAL in case of invalid spec
+ * @param[in]		spec: "us[:weight],..." (weight defaults to 1)
+ * @param[out]		g: distribution
+ * @DESCRIPTION		parse an idle gap distribution, a comma-separated list
+ *			of up to IDLEGAP_MAX_BINS gap lengths in us
+ *			([IDLEGAP_MIN_US-IDLEGAP_MAX_US]), each with an
+ *			optional integer weight ([1-1000]).
+ *//*------------------------------------------------------------------------ */
+int idlegap_parse(const char *spec, struct idlegap *g)
+{
+	long int us, weight;
+	uint32_t total = 0;
+	double sum = 0.0;
+	char *end;
+
+	if ((spec == NULL) || (g == NULL))
+		return -EINVAL;
+	memset(g, 0, sizeof(*g));
+	do {
+		if (g->count == IDLEGAP_MAX_BINS)
+			return -EINVAL;
+		us = strtol(spec, &end, 10);
+		if ((end == spec) || (us < IDLEGAP_MIN_US) ||
+			(us > IDLEGAP_MAX_US))
+			return -EINVAL;
+		weight = 1;
+		if (*end == ':') {
+			spec = end + 1;
+			weight = strtol(spec, &end, 10);
+			if ((end == spec) || (weight < 1) || (weight > 1000))
+				return -EINVAL;
+		}
+		if ((*end != ',') && (*end != '\0'))
+			return -EINVAL;
+		total += weight;
+		sum += (double) us * NSEC_PER_USEC * weight;
+		g->ns[g->count] = (uint64_t) us * NSEC_PER_USEC;
+		g->cdf[g->count] = total;
+		g->count++;
+		spec = end + 1;
+	} while (*end == ',');
+	g->mean_ns = sum / total;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		idlegap_draw
+ * @BRIEF		draw an idle gap length.
+ * @RETURNS		idle gap length, in ns
+ * @param[in]		g: distribution (count > 0)
+ * @param[in,out]	seed: caller's rand_r() state
+ * @DESCRIPTION		draw an idle gap length from a distribution. Lock-free:
+ *			the random state belongs to the calling thread.
+ *//*------------------------------------------------------------------------ */
+uint64_t idlegap_draw(const struct idlegap *g, unsigned int *seed)
+{
+	uint32_t r;
+	unsigned int i;
+
+	if (g->count == 1)
+		return g->ns[0];
+	r = (uint32_t) rand_r(seed) % g->cdf[g->count - 1];
+	for (i = 0; r >= g->cdf[i]; i++)
+		;
+	return g->ns[i];
+}
@@ -0,0 +1,69 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			idlegap.h
+ * @Description			Idle gap length distributions
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __IDLEGAP_H__
+#define __IDLEGAP_H__
+
+#include <stdint.h>
+
+#define IDLEGAP_MAX_BINS	16
+#define IDLEGAP_MIN_US		1
+#define IDLEGAP_MAX_US		10000000
+
+/*
+ * Discrete distribution of idle gap lengths: each bin is a length and a
+ * weight, e.g. "50:2,150:5,1000:3" (in us). A single length ("150") makes
+ * every gap the same.
+ */
+struct idlegap {
+	unsigned int count;
+	uint64_t ns[IDLEGAP_MAX_BINS];
+	uint32_t cdf[IDLEGAP_MAX_BINS];	/* cumulative weights */
+	double mean_ns;
+};
+
+
+int idlegap_parse(const char *spec, struct idlegap *g);
+uint64_t idlegap_draw(const struct idlegap *g, unsigned int *seed);
+
+
+#endif
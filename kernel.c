@@ -0,0 +1,480 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			kernel.c
+ * @Description			Workload kernels registry
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "cpuloadgen.h"
+#include "output.h"
+#include "kernel.h"
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sqrt_init
+ * @BRIEF		allocate the random generator state of a thread.
+ * @RETURNS		kernel state, NULL in case of error
+ * @param[in]		params: unused
+ * @param[out]		err: -ENOMEM in case of error
+ * @DESCRIPTION		allocate the random generator state of a thread.
+ *			Each thread has its own state (rand_r()): rand()
+ *			shares a locked state among all threads, which made
+ *			the legacy kernel scale poorly with core count.
+ *//*------------------------------------------------------------------------ */
+static void *sqrt_init(const char *params UNUSED, int *err)
+{
+	static unsigned int seed;
+	unsigned int *state;
+
+	state = malloc(sizeof(*state));
+	if (state == NULL) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+	*state = __atomic_add_fetch(&seed, 1, __ATOMIC_RELAXED);
+
+	return state;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sqrt_run
+ * @BRIEF		legacy busy loop kernel.
+ * @param[in,out]	state: random generator state
+ * @param[in]		iterations: number of kernel iterations
+ * @DESCRIPTION		legacy busy loop kernel.
+ *//*------------------------------------------------------------------------ */
+static void sqrt_run(void *state, unsigned int iterations)
+{
+	while (iterations-- > 0) {
+		sqrt(rand_r(state));
+	}
+}
+
+
+static const struct kernel kernel_base[] = {
+	{"sqrt", "", "", "", "square root of a random number (legacy)", NULL,
+		sqrt_init, sqrt_run, free, NULL}};
+
+static const struct kernel_table kernel_base_table = {
+	kernel_base, sizeof(kernel_base) / sizeof(kernel_base[0])};
+
+static const struct kernel_table *kernel_tables[] = {
+	&kernel_base_table,
+	&kernel_fma_table,
+	&kernel_mm_table,
+	&kernel_alloc_table};
+
+#define KERNEL_TABLES	(sizeof(kernel_tables) / sizeof(kernel_tables[0]))
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		kernel_param
+ * @BRIEF		return the value of a key in a "key=value,..." list.
+ * @RETURNS		value (copied into buf), NULL if key is not in list
+ * @param[in]		params: "key=value,..." list
+ * @param[in]		key: key
+ * @param[out]		buf: value buffer
+ * @param[in]		size: value buffer size
+ * @DESCRIPTION		return the value of a key in a "key=value,..." list.
+ *			A key given without value has an empty value.
+ *//*------------------------------------------------------------------------ */
+const char *kernel_param(const char *params, const char *key, char *buf,
+	size_t size)
+{
+	const char *p = params, *end, *eq;
+	size_t klen = strlen(key), vlen;
+
+	while ((p != NULL) && (*p != '\0')) {
+		end = strchr(p, ',');
+		if (end == NULL)
+			end = p + strlen(p);
+		eq = memchr(p, '=', end - p);
+		if ((eq == NULL ? (size_t) (end - p) : (size_t) (eq - p)) == klen &&
+			(strncmp(p, key, klen) == 0)) {
+			vlen = (eq == NULL) ? 0 : (size_t) (end - eq - 1);
+			if (vlen >= size)
+				vlen = size - 1;
+			memcpy(buf, eq == NULL ? end : eq + 1, vlen);
+			buf[vlen] = '\0';
+			return buf;
+		}
+		p = (*end == ',') ? end + 1 : end;
+	}
+
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		kernel_param_size
+ * @BRIEF		return a size parameter from a "key=value,..." list.
+ * @RETURNS		0 on success, -EINVAL in case of invalid value
+ * @param[in]		params: "key=value,..." list
+ * @param[in]		key: key
+ * @param[in]		def: default value, if key is not in list
+ * @param[out]		size: value, in bytes
+ * @DESCRIPTION		return a size parameter from a "key=value,..." list.
+ *			Values are in bytes, with an optional k, m or g
+ *			(binary) suffix, e.g. size=64m.
+ *//*------------------------------------------------------------------------ */
+int kernel_param_size(const char *params, const char *key, size_t def,
+	size_t *size)
+{
+	char buf[32], *end;
+	unsigned long long v;
+
+	if (kernel_param(params, key, buf, sizeof(buf)) == NULL) {
+		*size = def;
+		return 0;
+	}
+	v = strtoull(buf, &end, 10);
+	if (end == buf)
+		return -EINVAL;
+	switch (*end) {
+	case 'g':
+	case 'G':
+		v <<= 10;
+		/* fall through */
+	case 'm':
+	case 'M':
+		v <<= 10;
+		/* fall through */
+	case 'k':
+	case 'K':
+		v <<= 10;
+		end++;
+		break;
+	default:
+		break;
+	}
+	if ((*end != '\0') || (v == 0) || (v > KERNEL_SIZE_MAX))
+		return -EINVAL;
+	*size = (size_t) v;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		kernel_match
+ * @BRIEF		tell whether a variant matches parameters.
+ * @RETURNS		1 if variant matches, 0 otherwise
+ * @param[in]		k: kernel variant
+ * @param[in]		params: "key=value,..." list
+ * @DESCRIPTION		tell whether a variant matches parameters, i.e. if
+ *			each of its tags has the value of the parameter with
+ *			the same key, or else the kernel's default value.
+ *			Tags without parameter nor default match anything.
+ *//*------------------------------------------------------------------------ */
+static int kernel_match(const struct kernel *k, const char *params)
+{
+	char key[KERNEL_SPEC_MAX], val[KERNEL_SPEC_MAX], tag[KERNEL_SPEC_MAX];
+	const char *p = k->tags, *end, *eq;
+	size_t len;
+
+	while (*p != '\0') {
+		end = strchr(p, ',');
+		if (end == NULL)
+			end = p + strlen(p);
+		eq = memchr(p, '=', end - p);
+		len = (eq == NULL) ? (size_t) (end - p) : (size_t) (eq - p);
+		if (len < sizeof(key)) {
+			memcpy(key, p, len);
+			key[len] = '\0';
+			kernel_param(k->tags, key, tag, sizeof(tag));
+			if (((kernel_param(params, key, val, sizeof(val))
+				!= NULL) || (kernel_param(k->defaults, key, val,
+				sizeof(val)) != NULL)) && (strcmp(tag, val) != 0))
+				return 0;
+		}
+		p = (*end == ',') ? end + 1 : end;
+	}
+
+	return 1;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		kernel_check
+ * @BRIEF		check that a kernel knows all given parameters.
+ * @RETURNS		0 on success, -EINVAL in case of unknown parameter
+ * @param[in]		k: kernel variant
+ * @param[in]		params: "key=value,..." list
+ * @DESCRIPTION		check that a kernel knows all given parameters, i.e.
+ *			that each key is one of its tags or parameter keys,
+ *			so that typos do not silently run another variant.
+ *//*------------------------------------------------------------------------ */
+static int kernel_check(const struct kernel *k, const char *params)
+{
+	char key[KERNEL_SPEC_MAX], val[KERNEL_SPEC_MAX];
+	const char *p = params, *end, *eq;
+	size_t len;
+
+	while (*p != '\0') {
+		end = strchr(p, ',');
+		if (end == NULL)
+			end = p + strlen(p);
+		eq = memchr(p, '=', end - p);
+		len = (eq == NULL) ? (size_t) (end - p) : (size_t) (eq - p);
+		if ((len == 0) || (len >= sizeof(key)))
+			return -EINVAL;
+		memcpy(key, p, len);
+		key[len] = '\0';
+		if ((kernel_param(k->tags, key, val, sizeof(val)) == NULL) &&
+			(kernel_param(k->keys, key, val, sizeof(val)) == NULL))
+			return -EINVAL;
+		p = (*end == ',') ? end + 1 : end;
+	}
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		kernel_iteration_ns
+ * @BRIEF		measure the iteration time of a kernel variant.
+ * @RETURNS		best iteration time (ns), HUGE_VAL in case of error
+ * @param[in]		k: kernel variant
+ * @param[in]		params: kernel parameters
+ * @param[out]		err: 0 on success, error returned by the kernel
+ *			init() otherwise (e.g. -ENOENT, -ENOMEM)
+ * @DESCRIPTION		measure the iteration time of a kernel variant, best
+ *			of KERNEL_CALIBRATION_ROUNDS runs of about
+ *			KERNEL_CALIBRATION_NS each.
+ *//*------------------------------------------------------------------------ */
+double kernel_iteration_ns(const struct kernel *k, const char *params,
+	int *err)
+{
+	void *state = NULL;
+	uint64_t start, elapsed;
+	unsigned int n, r;
+	double best = HUGE_VAL;
+
+	*err = 0;
+	if (k->init != NULL) {
+		state = k->init(params, err);
+		if (state == NULL) {
+			if (*err == 0)
+				*err = -EINVAL;
+			return HUGE_VAL;
+		}
+	}
+	for (r = 0; r < KERNEL_CALIBRATION_ROUNDS; r++) {
+		n = 1;
+		do {
+			n *= 2;
+			start = now_ns();
+			k->run(state, n);
+			elapsed = now_ns() - start;
+		} while ((elapsed < KERNEL_CALIBRATION_NS) && (n < (1U << 30)));
+		if ((double) elapsed / n < best)
+			best = (double) elapsed / n;
+	}
+	if (k->deinit != NULL)
+		k->deinit(state);
+
+	return best;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		kernel_find
+ * @BRIEF		select a kernel variant from a kernel spec.
+ * @RETURNS		0 on success
+ *			-EINVAL if no kernel has that name, or in case of
+ *			unknown parameter
+ *			-ENOTSUP if no variant matches or runs on this CPU
+ * @param[in]		spec: "name[:key=value,...]" (NULL: default kernel)
+ * @param[out]		k: selected kernel variant
+ * @param[out]		params: kernel parameters (points into spec)
+ * @DESCRIPTION		select a kernel variant from a kernel spec. When
+ *			several supported variants match, each one is timed
+ *			and the fastest is selected.
+ *//*------------------------------------------------------------------------ */
+int kernel_find(const char *spec, const struct kernel **k,
+	const char **params)
+{
+	const struct kernel *v, *best = NULL;
+	const char *colon;
+	double ns, best_ns = HUGE_VAL;
+	size_t len;
+	unsigned int t, i, named = 0, matches = 0;
+	int err;
+
+	if (spec == NULL)
+		spec = KERNEL_DEFAULT;
+	colon = strchr(spec, ':');
+	len = (colon == NULL) ? strlen(spec) : (size_t) (colon - spec);
+	*params = (colon == NULL) ? "" : colon + 1;
+
+	for (t = 0; t < KERNEL_TABLES; t++) {
+		for (i = 0; i < kernel_tables[t]->count; i++) {
+			v = &kernel_tables[t]->kernels[i];
+			if ((strlen(v->name) != len) ||
+				(strncmp(v->name, spec, len) != 0))
+				continue;
+			if ((++named == 1) && (kernel_check(v, *params) != 0))
+				return -EINVAL;
+			if (((v->supported != NULL) && !v->supported()) ||
+				!kernel_match(v, *params))
+				continue;
+			if (++matches == 1) {
+				best = v;
+				continue;
+			}
+			/* Several candidates: time them */
+			if (best_ns == HUGE_VAL)
+				best_ns = kernel_iteration_ns(best, *params,
+					&err);
+			ns = kernel_iteration_ns(v, *params, &err);
+			if (ns < best_ns) {
+				best = v;
+				best_ns = ns;
+			}
+		}
+	}
+
+	if (named == 0)
+		return -EINVAL;
+	if (best == NULL)
+		return -ENOTSUP;
+	*k = best;
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		kernel_spec
+ * @BRIEF		format the spec that selects exactly a kernel variant.
+ * @RETURNS		number of characters written (see snprintf())
+ * @param[in]		k: kernel variant
+ * @param[in]		params: kernel parameters
+ * @param[out]		buf: spec buffer
+ * @param[in]		size: spec buffer size
+ * @DESCRIPTION		format the spec that selects exactly a kernel variant
+ *			with the same parameters ("name:tags,params").
+ *//*------------------------------------------------------------------------ */
+int kernel_spec(const struct kernel *k, const char *params, char *buf,
+	size_t size)
+{
+	char key[KERNEL_SPEC_MAX], tag[KERNEL_SPEC_MAX];
+	const char *p = params, *end, *eq;
+	size_t len;
+	int n;
+
+	n = snprintf(buf, size, "%s%s%s", k->name, *k->tags ? ":" : "",
+		k->tags);
+	/* Append parameters which are not variant tags */
+	while ((*p != '\0') && (n >= 0) && ((size_t) n < size)) {
+		end = strchr(p, ',');
+		if (end == NULL)
+			end = p + strlen(p);
+		eq = memchr(p, '=', end - p);
+		len = (eq == NULL) ? (size_t) (end - p) : (size_t) (eq - p);
+		if (len < sizeof(key)) {
+			memcpy(key, p, len);
+			key[len] = '\0';
+			if (kernel_param(k->tags, key, tag, sizeof(tag)) == NULL)
+				n += snprintf(buf + n, size - n, "%s%.*s",
+					(n == (int) strlen(k->name)) ? ":" : ",",
+					(int) (end - p), p);
+		}
+		p = (*end == ',') ? end + 1 : end;
+	}
+
+	return n;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		kernel_name
+ * @BRIEF		return the name of a kernel.
+ * @RETURNS		name of the i-th kernel, NULL if i is out of range
+ * @param[in]		i: kernel index (variants of a kernel count once)
+ * @DESCRIPTION		return the name of a kernel, to iterate over kernels
+ *			regardless of their variants.
+ *//*------------------------------------------------------------------------ */
+const char *kernel_name(unsigned int i)
+{
+	const char *name = NULL;
+	unsigned int t, j;
+
+	for (t = 0; t < KERNEL_TABLES; t++) {
+		for (j = 0; j < kernel_tables[t]->count; j++) {
+			if ((name != NULL) &&
+				(strcmp(name, kernel_tables[t]->kernels[j].name) == 0))
+				continue;
+			name = kernel_tables[t]->kernels[j].name;
+			if (i-- == 0)
+				return name;
+		}
+	}
+
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		kernel_list
+ * @BRIEF		print all kernel variants.
+ * @DESCRIPTION		print all kernel variants, and whether this CPU
+ *			supports them.
+ *//*------------------------------------------------------------------------ */
+void kernel_list(void)
+{
+	const struct kernel *v;
+	unsigned int t, i;
+
+	iprintf("Kernels (name[:key=value,...]):\n");
+	for (t = 0; t < KERNEL_TABLES; t++) {
+		for (i = 0; i < kernel_tables[t]->count; i++) {
+			v = &kernel_tables[t]->kernels[i];
+			iprintf("\t%s%s%-*s %s%s\n", v->name, *v->tags ? ":" : "",
+				(int) (32 - strlen(v->name) - !!*v->tags),
+				v->tags, v->desc,
+				((v->supported == NULL) || v->supported()) ?
+				"" : " (not supported by this CPU)");
+		}
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			kernel.h
+ * @Description			Workload kernels registry
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __KERNEL_H__
+#define __KERNEL_H__
+
+#include <stddef.h>
+
+#define KERNEL_DEFAULT		"sqrt"
+#define KERNEL_SPEC_MAX		128
+#define KERNEL_CALIBRATION_NS	1000000	/* per variant and round */
+#define KERNEL_CALIBRATION_ROUNDS	3
+#define KERNEL_SIZE_MAX		(1ULL << 40)	/* size parameters */
+
+/*
+ * A workload kernel variant. Variants of a kernel share its name and differ
+ * by their tags ("key=value,..."), e.g. data type, unroll factor or ISA
+ * level. A kernel spec "name[:key=value,...]" selects the variants whose
+ * tags match all given keys they know; other keys are kernel parameters,
+ * passed to init(), and must be listed in keys. A tag key that is not given
+ * takes its default value, if the kernel has one (e.g. variants that measure
+ * different things rather than implement the same work). When several
+ * variants match, the fastest one on this machine is picked.
+ */
+struct kernel {
+	const char *name;
+	const char *tags;	/* "" if single variant */
+	const char *defaults;	/* tag values when not given, "" if none */
+	const char *keys;	/* parameter keys ("key,..."), "" if none */
+	const char *desc;
+	int (*supported)(void);	/* NULL: supported everywhere */
+	void *(*init)(const char *params, int *err); /* NULL: stateless */
+	void (*run)(void *state, unsigned int iterations);
+	void (*deinit)(void *state);
+	/* NULL: nothing to report; else called by load threads once done */
+	void (*report)(void *state, unsigned int cpu);
+};
+
+/* Per-file variant tables, gathered by kernel.c */
+struct kernel_table {
+	const struct kernel *kernels;
+	unsigned int count;
+};
+
+extern const struct kernel_table kernel_fma_table;
+extern const struct kernel_table kernel_mm_table;
+extern const struct kernel_table kernel_alloc_table;
+
+int kernel_find(const char *spec, const struct kernel **k,
+	const char **params);
+double kernel_iteration_ns(const struct kernel *k, const char *params,
+	int *err);
+int kernel_spec(const struct kernel *k, const char *params, char *buf,
+	size_t size);
+const char *kernel_param(const char *params, const char *key, char *buf,
+	size_t size);
+int kernel_param_size(const char *params, const char *key, size_t def,
+	size_t *size);
+const char *kernel_name(unsigned int i);
+void kernel_list(void);
+
+
+#endif
@@ -0,0 +1,382 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			kernel_alloc.c
+ * @Description			Memory allocator stress kernel
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "cpuloadgen.h"
+#include "output.h"
+#include "kernel.h"
+
+/*
+ * Allocator stress kernel: each thread keeps a live set of objects, and an
+ * iteration replaces a random one (one free and one malloc, of a size drawn
+ * from a distribution), touching one byte per page of the new object. With
+ * cross-thread frees, freed objects are handed over through shared
+ * exchange slots and freed by whichever thread picks them up; each one
+ * carries its owner's id in its first bytes (sizes are at least 16 bytes),
+ * so that only frees of other threads' objects count as cross-thread. It
+ * calls the system allocator, or one preloaded with LD_PRELOAD.
+ */
+#define ALLOC_DEFAULT_LIVE	1024
+#define ALLOC_MAX_LIVE		(1U << 24)
+#define ALLOC_EXCHANGE_SLOTS	64
+#define ALLOC_PAGE		4096
+
+typedef enum {
+	ALLOC_DIST_SMALL,	/* 16B-256B */
+	ALLOC_DIST_MIXED,	/* 90% small, 9% up to 32KB, 1% up to 256KB */
+	ALLOC_DIST_LARGE,	/* 32KB-1MB */
+	ALLOC_DIST_MAX
+} alloc_dist;
+
+static const char *alloc_dist_names[ALLOC_DIST_MAX] = {
+	"small", "mixed", "large"};
+
+struct alloc_state {
+	alloc_dist dist;
+	int cross;		/* hand frees over to other threads */
+	unsigned int live;	/* live set size (objects) */
+	void **objs;
+	size_t *sizes;
+	size_t live_bytes;	/* requested bytes in live set */
+	unsigned int id;	/* owner id of exchanged objects */
+	unsigned int seed;
+	uint64_t ops;		/* malloc + free pairs */
+	uint64_t handoffs;	/* frees of other threads' objects */
+	uint64_t start_ns;	/* first run */
+	long long rss_start;
+};
+
+/* Objects in transit between threads */
+static void *alloc_exchange[ALLOC_EXCHANGE_SLOTS];
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		alloc_rss
+ * @BRIEF		return the process resident set size.
+ * @RETURNS		resident set size in bytes, -1 in case of error
+ * @DESCRIPTION		return the process resident set size, from
+ *			/proc/self/statm.
+ *//*------------------------------------------------------------------------ */
+static long long alloc_rss(void)
+{
+	long long size, rss;
+	FILE *fp;
+	int ret;
+
+	fp = fopen("/proc/self/statm", "r");
+	if (fp == NULL)
+		return -1;
+	ret = fscanf(fp, "%lld %lld", &size, &rss);
+	fclose(fp);
+	if (ret != 2)
+		return -1;
+	return rss * sysconf(_SC_PAGESIZE);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		alloc_size
+ * @BRIEF		draw an allocation size.
+ * @RETURNS		allocation size, in bytes
+ * @param[in,out]	s: kernel state
+ * @DESCRIPTION		draw an allocation size from the state distribution.
+ *			Within a range, sizes are log-uniform, so that small
+ *			sizes dominate as in real programs.
+ *//*------------------------------------------------------------------------ */
+static size_t alloc_size(struct alloc_state *s)
+{
+	unsigned int r = (unsigned int) rand_r(&s->seed);
+	unsigned int lo, hi, p;
+
+	switch (s->dist) {
+	case ALLOC_DIST_SMALL:
+		lo = 4;
+		hi = 8;
+		break;
+	case ALLOC_DIST_LARGE:
+		lo = 15;
+		hi = 20;
+		break;
+	default:
+		p = r % 100;
+		lo = 4;
+		hi = (p < 90) ? 8 : (p < 99) ? 15 : 18;
+		if (p >= 90)
+			lo = (p < 99) ? 8 : 15;
+		break;
+	}
+	p = lo + (r >> 8) % (hi - lo);
+	return ((size_t) 1 << p) + ((size_t) (r >> 16) % ((size_t) 1 << p));
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		alloc_new
+ * @BRIEF		allocate and touch an object.
+ * @RETURNS		object, NULL in case of allocation failure
+ * @param[in]		size: object size
+ * @DESCRIPTION		allocate an object and touch one byte per page of it,
+ *			so that its memory is actually committed.
+ *//*------------------------------------------------------------------------ */
+static void *alloc_new(size_t size)
+{
+	char *p = malloc(size);
+	size_t off;
+
+	if (p == NULL)
+		return NULL;
+	for (off = 0; off < size; off += ALLOC_PAGE)
+		((volatile char *) p)[off] = 1;
+	((volatile char *) p)[size - 1] = 1;
+	return p;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		alloc_free
+ * @BRIEF		free an object, possibly through another thread.
+ * @param[in,out]	s: kernel state
+ * @param[in]		p: object
+ * @DESCRIPTION		free an object. With cross-thread frees, the object is
+ *			tagged with its owner and swapped into a random
+ *			exchange slot instead, and whatever was there is
+ *			freed, counting a handoff if another thread owned it.
+ *//*------------------------------------------------------------------------ */
+static void alloc_free(struct alloc_state *s, void *p)
+{
+	if (s->cross) {
+		*(unsigned int *) p = s->id;
+		p = __atomic_exchange_n(&alloc_exchange[(unsigned int)
+			rand_r(&s->seed) % ALLOC_EXCHANGE_SLOTS], p,
+			__ATOMIC_ACQ_REL);
+		if (p == NULL)
+			return;
+		if (*(unsigned int *) p != s->id)
+			s->handoffs++;
+	}
+	free(p);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		alloc_deinit
+ * @BRIEF		free the allocator kernel state.
+ * @param[in,out]	state: kernel state
+ * @DESCRIPTION		free the allocator kernel state and its live set.
+ *			Objects left in exchange slots are freed too: they
+ *			belong to no live set.
+ *//*------------------------------------------------------------------------ */
+static void alloc_deinit(void *state)
+{
+	struct alloc_state *s = state;
+	unsigned int i;
+
+	for (i = 0; i < s->live; i++)
+		free(s->objs[i]);
+	if (s->cross)
+		for (i = 0; i < ALLOC_EXCHANGE_SLOTS; i++)
+			free(__atomic_exchange_n(&alloc_exchange[i], NULL,
+				__ATOMIC_ACQ_REL));
+	free(s->objs);
+	free(s->sizes);
+	free(s);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		alloc_init
+ * @BRIEF		allocate the allocator kernel state.
+ * @RETURNS		kernel state, NULL in case of error (err set)
+ * @param[in]		params: dist=small|mixed|large, live=objects, cross=1
+ * @param[out]		err: -EINVAL in case of invalid parameter, -ENOMEM
+ *			in case of allocation failure
+ * @DESCRIPTION		allocate the allocator kernel state and fill its live
+ *			set.
+ *//*------------------------------------------------------------------------ */
+static void *alloc_init(const char *params, int *err)
+{
+	static unsigned int seed;
+	char buf[16], *end;
+	struct alloc_state *s;
+	unsigned int i;
+	long v;
+
+	s = calloc(1, sizeof(*s));
+	if (s == NULL) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+	s->dist = ALLOC_DIST_MIXED;
+	if (kernel_param(params, "dist", buf, sizeof(buf)) != NULL) {
+		for (i = 0; i < ALLOC_DIST_MAX; i++)
+			if (strcmp(buf, alloc_dist_names[i]) == 0)
+				break;
+		if (i == ALLOC_DIST_MAX)
+			goto einval;
+		s->dist = (alloc_dist) i;
+	}
+	s->live = ALLOC_DEFAULT_LIVE;
+	if (kernel_param(params, "live", buf, sizeof(buf)) != NULL) {
+		v = strtol(buf, &end, 10);
+		if ((end == buf) || (*end != '\0') || (v < 1) ||
+			(v > ALLOC_MAX_LIVE))
+			goto einval;
+		s->live = (unsigned int) v;
+	}
+	if (kernel_param(params, "cross", buf, sizeof(buf)) != NULL) {
+		if ((strcmp(buf, "0") != 0) && (strcmp(buf, "1") != 0))
+			goto einval;
+		s->cross = (buf[0] == '1');
+	}
+	s->seed = __atomic_add_fetch(&seed, 1, __ATOMIC_RELAXED);
+	s->id = s->seed;
+	s->objs = calloc(s->live, sizeof(void *));
+	s->sizes = calloc(s->live, sizeof(size_t));
+	if ((s->objs == NULL) || (s->sizes == NULL))
+		goto enomem;
+	s->rss_start = alloc_rss();
+	for (i = 0; i < s->live; i++) {
+		s->sizes[i] = alloc_size(s);
+		s->objs[i] = alloc_new(s->sizes[i]);
+		if (s->objs[i] == NULL)
+			goto enomem;
+		s->live_bytes += s->sizes[i];
+	}
+
+	return s;
+
+enomem:
+	alloc_deinit(s);
+	*err = -ENOMEM;
+	return NULL;
+
+einval:
+	free(s);
+	*err = -EINVAL;
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		alloc_run
+ * @BRIEF		run the allocator kernel.
+ * @param[in,out]	state: kernel state
+ * @param[in]		iterations: objects to replace (one free and one
+ *			malloc each)
+ * @DESCRIPTION		run the allocator kernel: free random live objects
+ *			and replace them with new ones. An allocation failure
+ *			leaves the slot empty until a later iteration.
+ *//*------------------------------------------------------------------------ */
+static void alloc_run(void *state, unsigned int iterations)
+{
+	struct alloc_state *s = state;
+	unsigned int i;
+
+	if (s->start_ns == 0)
+		s->start_ns = now_ns();
+	while (iterations-- > 0) {
+		i = (unsigned int) rand_r(&s->seed) % s->live;
+		if (s->objs[i] != NULL) {
+			alloc_free(s, s->objs[i]);
+			s->live_bytes -= s->sizes[i];
+		}
+		s->sizes[i] = alloc_size(s);
+		s->objs[i] = alloc_new(s->sizes[i]);
+		if (s->objs[i] != NULL)
+			s->live_bytes += s->sizes[i];
+		s->ops++;
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		alloc_report
+ * @BRIEF		print and emit allocator kernel results.
+ * @param[in]		state: kernel state
+ * @param[in]		cpu: CPU core ID of the load thread
+ * @DESCRIPTION		print and emit allocator kernel results of a load
+ *			thread: malloc/free pairs per second of run time,
+ *			live set, cross-thread frees, and process RSS growth
+ *			since the thread started (RSS is not per-thread).
+ *//*------------------------------------------------------------------------ */
+static void alloc_report(void *state, unsigned int cpu)
+{
+	struct alloc_state *s = state;
+	double secs, rate;
+	long long rss = alloc_rss();
+
+	secs = (s->start_ns != 0) ?
+		(double) (now_ns() - s->start_ns) / NSEC_PER_SEC : 0.0;
+	rate = (secs > 0.0) ? s->ops / secs : 0.0;
+	iprintf("CPU%u: alloc %s live %u (%.1f MB) %.0f ops/s cross-thread frees %llu process RSS %+.1f MB\n",
+		cpu, alloc_dist_names[s->dist], s->live,
+		s->live_bytes / 1048576.0, rate,
+		(unsigned long long) s->handoffs,
+		(rss - s->rss_start) / 1048576.0);
+
+	output_begin("alloc");
+	output_field_int("cpu", cpu);
+	output_field_str("dist", alloc_dist_names[s->dist]);
+	output_field_int("live", s->live);
+	output_field_u64("live_bytes", s->live_bytes);
+	output_field_int("cross", s->cross);
+	output_field_u64("ops", s->ops);
+	output_field_double("ops_per_sec", rate);
+	output_field_u64("cross_frees", s->handoffs);
+	output_field_int("rss_start", s->rss_start);
+	output_field_int("rss_end", rss);
+	output_end();
+}
+
+
+static const struct kernel kernel_alloc[] = {
+	{"alloc", "", "", "dist,live,cross",
+		"malloc/free a live set (dist=small|mixed|large,live=,cross=1)",
+		NULL, alloc_init, alloc_run, alloc_deinit, alloc_report},
+};
+
+const struct kernel_table kernel_alloc_table = {
+	kernel_alloc, sizeof(kernel_alloc) / sizeof(kernel_alloc[0])};
@@ -0,0 +1,173 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			kernel_fma.c
+ * @Description			Multi-versioned multiply-add kernels
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdint.h>
+#include "cpuloadgen.h"
+#include "kernel.h"
+
+/*
+ * Multiply-add kernel, generated for every (data type, unroll factor, ISA
+ * level) combination. An iteration always performs FMA_OPS multiply-adds;
+ * the unroll factor is the number of independent dependency chains they are
+ * split into (1: latency bound, 16: throughput bound once vectorized).
+ * ISA-specific variants are compiled with a target attribute and only
+ * selected when the CPU supports them, so the binary stays portable.
+ */
+#define FMA_OPS		256
+
+#define FMA_MUL_float	0.999999f
+#define FMA_ADD_float	1.0e-6f
+#define FMA_MUL_double	0.999999
+#define FMA_ADD_double	1.0e-6
+#define FMA_MUL_int32	3U
+#define FMA_ADD_int32	1U
+#define FMA_MUL_int64	3ULL
+#define FMA_ADD_int64	1ULL
+
+typedef float fma_float;
+typedef double fma_double;
+typedef uint32_t fma_int32;
+typedef uint64_t fma_int64;
+
+/* Operands and result go through volatiles, so nothing is constant-folded */
+static volatile double fma_sink;
+static volatile fma_float fma_mul_float = FMA_MUL_float;
+static volatile fma_float fma_add_float = FMA_ADD_float;
+static volatile fma_double fma_mul_double = FMA_MUL_double;
+static volatile fma_double fma_add_double = FMA_ADD_double;
+static volatile fma_int32 fma_mul_int32 = FMA_MUL_int32;
+static volatile fma_int32 fma_add_int32 = FMA_ADD_int32;
+static volatile fma_int64 fma_mul_int64 = FMA_MUL_int64;
+static volatile fma_int64 fma_add_int64 = FMA_ADD_int64;
+
+#define FMA_KERNEL(tname, unroll, isa, attr, sup)			\
+attr static void fma_##tname##_u##unroll##_##isa(void *state UNUSED,	\
+	unsigned int iterations)					\
+{									\
+	fma_##tname acc[unroll];					\
+	fma_##tname mul = fma_mul_##tname, add = fma_add_##tname;	\
+	unsigned int i, j;						\
+	double sum = 0.0;						\
+									\
+	for (j = 0; j < unroll; j++)					\
+		acc[j] = (fma_##tname) (j + 2);				\
+	while (iterations-- > 0)					\
+		for (i = 0; i < FMA_OPS / unroll; i++)			\
+			_Pragma("GCC unroll 16")			\
+			for (j = 0; j < unroll; j++)			\
+				acc[j] = acc[j] * mul + add;		\
+	for (j = 0; j < unroll; j++)					\
+		sum += (double) acc[j];					\
+	fma_sink = sum;							\
+}
+
+#define FMA_ENTRY(tname, unroll, isa, attr, sup)			\
+	{"fma", "type=" #tname ",unroll=" #unroll ",isa=" #isa,		\
+		"", "", "multiply-add chains", sup, NULL,		\
+		fma_##tname##_u##unroll##_##isa, NULL, NULL},
+
+#define FMA_VARIANTS(X, isa, attr, sup)					\
+	X(float, 1, isa, attr, sup)					\
+	X(float, 4, isa, attr, sup)					\
+	X(float, 16, isa, attr, sup)					\
+	X(double, 1, isa, attr, sup)					\
+	X(double, 4, isa, attr, sup)					\
+	X(double, 16, isa, attr, sup)					\
+	X(int32, 1, isa, attr, sup)					\
+	X(int32, 4, isa, attr, sup)					\
+	X(int32, 16, isa, attr, sup)					\
+	X(int64, 1, isa, attr, sup)					\
+	X(int64, 4, isa, attr, sup)					\
+	X(int64, 16, isa, attr, sup)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FMA_ATTR_AVX2	__attribute__((target("avx2,fma")))
+#define FMA_ATTR_AVX512	\
+	__attribute__((target("avx512f,avx512vl,avx512dq,fma,prefer-vector-width=512")))
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		fma_avx2_supported
+ * @BRIEF		tell whether the CPU supports AVX2 and FMA.
+ * @RETURNS		1 if supported, 0 otherwise
+ * @DESCRIPTION		tell whether the CPU supports AVX2 and FMA.
+ *//*------------------------------------------------------------------------ */
+static int fma_avx2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		fma_avx512_supported
+ * @BRIEF		tell whether the CPU supports AVX-512 (F, VL, DQ).
+ * @RETURNS		1 if supported, 0 otherwise
+ * @DESCRIPTION		tell whether the CPU supports AVX-512 (F, VL, DQ).
+ *//*------------------------------------------------------------------------ */
+static int fma_avx512_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f") &&
+		__builtin_cpu_supports("avx512vl") &&
+		__builtin_cpu_supports("avx512dq") &&
+		__builtin_cpu_supports("fma");
+}
+#endif
+
+
+FMA_VARIANTS(FMA_KERNEL, base, , NULL)
+#if defined(__x86_64__) || defined(__i386__)
+FMA_VARIANTS(FMA_KERNEL, avx2, FMA_ATTR_AVX2, fma_avx2_supported)
+FMA_VARIANTS(FMA_KERNEL, avx512, FMA_ATTR_AVX512, fma_avx512_supported)
+#endif
+
+static const struct kernel kernel_fma[] = {
+	FMA_VARIANTS(FMA_ENTRY, base, , NULL)
+#if defined(__x86_64__) || defined(__i386__)
+	FMA_VARIANTS(FMA_ENTRY, avx2, FMA_ATTR_AVX2, fma_avx2_supported)
+	FMA_VARIANTS(FMA_ENTRY, avx512, FMA_ATTR_AVX512, fma_avx512_supported)
+#endif
+};
+
+const struct kernel_table kernel_fma_table = {
+	kernel_fma, sizeof(kernel_fma) / sizeof(kernel_fma[0])};
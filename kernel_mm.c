@@ -0,0 +1,518 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			kernel_mm.c
+ * @Description			Memory-management kernels
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "cpuloadgen.h"
+#include "output.h"
+#include "kernel.h"
+
+/*
+ * Page fault kernel: an iteration touches the next page of a mapping, which
+ * takes a fault; once every page was touched, the mapping is torn down and
+ * mapped again, so that the kernel memory-management paths (mmap_lock, page
+ * allocator, page cache) are loaded rather than user-space ALUs. File
+ * mappings disable readahead, so that a fault does not bring in (and
+ * fault-around does not map) the next pages. Faults actually taken are
+ * counted with getrusage() and reported.
+ */
+#define PF_DEFAULT_SIZE		(16ULL << 20)
+#define PF_HUGE_PAGE		(2ULL << 20)	/* THP (PMD) size */
+
+/*
+ * TLB pressure kernel: a random cyclic pointer chase with one node every
+ * stride bytes of a footprint larger than the TLB reach with 4K pages, but
+ * within it with 2MB pages. Every load depends on the previous one, so
+ * translation misses are not hidden. Backings (variants) only differ by
+ * how the footprint is mapped.
+ */
+#define TLB_DEFAULT_SIZE	(64ULL << 20)
+#define TLB_DEFAULT_STRIDE	4096
+#define TLB_LINE		64
+
+typedef enum {
+	TLB_BACKING_4K,		/* THP disabled on the mapping */
+	TLB_BACKING_THP,	/* madvise(MADV_HUGEPAGE) */
+	TLB_BACKING_HUGETLB	/* MAP_HUGETLB, from the hugetlbfs pool */
+} tlb_backing;
+
+struct tlb_state {
+	char *map;
+	size_t len;		/* mapped length */
+	void **cur;		/* chase position */
+};
+
+static volatile void *tlb_sink;
+
+struct pf_state {
+	size_t size;		/* mapping size */
+	size_t page;		/* page size: stride between faults */
+	int huge;		/* THP requested */
+	int fd;			/* -1: anonymous, else file for major faults */
+	char *map;
+	char *base;		/* aligned start within map */
+	size_t off;		/* next page to touch */
+	unsigned int sink;
+	uint64_t iterations;
+	uint64_t start_ns;	/* first run */
+	long start_minflt;	/* thread fault counts at first run */
+	long start_majflt;
+};
+
+static volatile unsigned int pf_sink;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		pf_map
+ * @BRIEF		map the page fault kernel region.
+ * @RETURNS		0 on success, -errno otherwise
+ * @param[in,out]	s: kernel state
+ * @DESCRIPTION		map the page fault kernel region: anonymous (minor
+ *			faults, THP-aligned if huge pages are requested) or
+ *			file-backed, private and read-only (major faults once
+ *			evicted from the page cache, one per page: readahead
+ *			is disabled on the mapping).
+ *//*------------------------------------------------------------------------ */
+static int pf_map(struct pf_state *s)
+{
+	size_t len = s->size + (s->huge ? PF_HUGE_PAGE : 0);
+	uintptr_t a;
+
+	if (s->fd >= 0) {
+		s->map = mmap(NULL, s->size, PROT_READ, MAP_PRIVATE, s->fd, 0);
+		if (s->map == MAP_FAILED)
+			return -errno;
+		s->base = s->map;
+		madvise(s->map, s->size, MADV_RANDOM);
+		return 0;
+	}
+	s->map = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (s->map == MAP_FAILED)
+		return -errno;
+	s->base = s->map;
+	if (s->huge) {
+		a = ((uintptr_t) s->map + PF_HUGE_PAGE - 1) &
+			~(uintptr_t) (PF_HUGE_PAGE - 1);
+		s->base = (char *) a;
+		madvise(s->base, s->size, MADV_HUGEPAGE);
+	} else {
+		/* Keep 4K faults even if THP is enabled system-wide */
+		madvise(s->base, s->size, MADV_NOHUGEPAGE);
+	}
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		pf_unmap
+ * @BRIEF		unmap the page fault kernel region.
+ * @param[in,out]	s: kernel state
+ * @DESCRIPTION		unmap the page fault kernel region, and drop the file
+ *			pages from the page cache so that they fault in from
+ *			disk again.
+ *//*------------------------------------------------------------------------ */
+static void pf_unmap(struct pf_state *s)
+{
+	if (s->map != MAP_FAILED)
+		munmap(s->map, s->size +
+			((s->fd < 0) && s->huge ? PF_HUGE_PAGE : 0));
+	if (s->fd >= 0)
+		posix_fadvise(s->fd, 0, s->size, POSIX_FADV_DONTNEED);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		pf_deinit
+ * @BRIEF		free the page fault kernel state.
+ * @param[in,out]	state: kernel state
+ * @DESCRIPTION		free the page fault kernel state.
+ *//*------------------------------------------------------------------------ */
+static void pf_deinit(void *state)
+{
+	struct pf_state *s = state;
+
+	pf_unmap(s);
+	if (s->fd >= 0)
+		close(s->fd);
+	free(s);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		pf_init
+ * @BRIEF		allocate the page fault kernel state.
+ * @RETURNS		kernel state, NULL in case of error (err set)
+ * @param[in]		params: size=bytes, page=4k|2m, file=path
+ * @param[out]		err: -EINVAL in case of invalid parameter (or file
+ *			smaller than size), -errno otherwise
+ * @DESCRIPTION		allocate the page fault kernel state. file selects a
+ *			file on local storage for major faults; it must be at
+ *			least size bytes long (e.g. created with dd).
+ *//*------------------------------------------------------------------------ */
+static void *pf_init(const char *params, int *err)
+{
+	char path[KERNEL_SPEC_MAX];
+	struct pf_state *s;
+	struct stat st;
+	size_t sys_page = (size_t) sysconf(_SC_PAGESIZE);
+
+	s = calloc(1, sizeof(*s));
+	if (s == NULL) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+	s->fd = -1;
+	if ((kernel_param_size(params, "size", PF_DEFAULT_SIZE, &s->size) != 0)
+		|| (kernel_param_size(params, "page", sys_page, &s->page) != 0)
+		|| ((s->page != sys_page) && (s->page != PF_HUGE_PAGE)) ||
+		(s->size < s->page))
+		goto einval;
+	s->huge = (s->page == PF_HUGE_PAGE);
+	s->size -= s->size % s->page;
+	if (kernel_param(params, "file", path, sizeof(path)) != NULL) {
+		if (s->huge)
+			goto einval;
+		s->fd = open(path, O_RDONLY);
+		if (s->fd < 0) {
+			*err = -errno;
+			free(s);
+			return NULL;
+		}
+		if ((fstat(s->fd, &st) != 0) || ((size_t) st.st_size < s->size))
+			goto einval;
+		posix_fadvise(s->fd, 0, s->size, POSIX_FADV_RANDOM);
+		posix_fadvise(s->fd, 0, s->size, POSIX_FADV_DONTNEED);
+	}
+	*err = pf_map(s);
+	if (*err != 0) {
+		if (s->fd >= 0)
+			close(s->fd);
+		free(s);
+		return NULL;
+	}
+
+	return s;
+
+einval:
+	if (s->fd >= 0)
+		close(s->fd);
+	free(s);
+	*err = -EINVAL;
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		pf_run
+ * @BRIEF		run the page fault kernel.
+ * @param[in,out]	state: kernel state
+ * @param[in]		iterations: pages to touch (one fault each)
+ * @DESCRIPTION		run the page fault kernel: touch the next pages of the
+ *			region (write if anonymous, read if file-backed),
+ *			remapping it once every page was touched.
+ *//*------------------------------------------------------------------------ */
+static void pf_run(void *state, unsigned int iterations)
+{
+	struct pf_state *s = state;
+	struct rusage ru;
+
+	if ((s->start_ns == 0) && (getrusage(RUSAGE_THREAD, &ru) == 0)) {
+		s->start_ns = now_ns();
+		s->start_minflt = ru.ru_minflt;
+		s->start_majflt = ru.ru_majflt;
+	}
+	s->iterations += iterations;
+	while (iterations-- > 0) {
+		if (s->off >= s->size) {
+			pf_unmap(s);
+			if (pf_map(s) != 0) {
+				/* Out of memory: nothing left to fault in */
+				s->map = MAP_FAILED;
+				return;
+			}
+			s->off = 0;
+		}
+		if (s->fd >= 0)
+			s->sink += *(volatile char *) (s->base + s->off);
+		else
+			*(volatile char *) (s->base + s->off) = 1;
+		s->off += s->page;
+	}
+	pf_sink = s->sink;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		pf_report
+ * @BRIEF		print and emit page fault kernel results.
+ * @param[in]		state: kernel state
+ * @param[in]		cpu: CPU core ID of the load thread
+ * @DESCRIPTION		print and emit page fault kernel results of a load
+ *			thread: minor and major faults it took per second of
+ *			run time (getrusage()), next to touched pages per
+ *			second.
+ *//*------------------------------------------------------------------------ */
+static void pf_report(void *state, unsigned int cpu)
+{
+	struct pf_state *s = state;
+	struct rusage ru;
+	long minflt = 0, majflt = 0;
+	double secs;
+
+	if ((s->start_ns != 0) && (getrusage(RUSAGE_THREAD, &ru) == 0)) {
+		minflt = ru.ru_minflt - s->start_minflt;
+		majflt = ru.ru_majflt - s->start_majflt;
+	}
+	secs = (s->start_ns != 0) ?
+		(double) (now_ns() - s->start_ns) / NSEC_PER_SEC : 0.0;
+	if (secs <= 0.0)
+		secs = 1.0;
+	iprintf("CPU%u: pagefault %.0f pages/s, %.0f minor faults/s, %.0f major faults/s\n",
+		cpu, s->iterations / secs, minflt / secs, majflt / secs);
+
+	output_begin("pagefault");
+	output_field_int("cpu", cpu);
+	output_field_u64("pages", s->iterations);
+	output_field_int("minor_faults", minflt);
+	output_field_int("major_faults", majflt);
+	output_field_double("seconds", secs);
+	output_end();
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		tlb_deinit
+ * @BRIEF		free the TLB kernel state.
+ * @param[in,out]	state: kernel state
+ * @DESCRIPTION		free the TLB kernel state.
+ *//*------------------------------------------------------------------------ */
+static void tlb_deinit(void *state)
+{
+	struct tlb_state *s = state;
+
+	tlb_sink = s->cur;
+	munmap(s->map, s->len);
+	free(s);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		tlb_init
+ * @BRIEF		allocate the TLB kernel state.
+ * @RETURNS		kernel state, NULL in case of error (err set)
+ * @param[in]		params: size=bytes, stride=bytes
+ * @param[out]		err: -EINVAL in case of invalid parameter,
+ *			-errno otherwise (e.g. -ENOMEM if the hugetlbfs pool
+ *			is too small)
+ * @param[in]		backing: footprint backing
+ * @DESCRIPTION		allocate the TLB kernel state: map and populate the
+ *			footprint, and link one node per stride (at varying
+ *			cache line offsets, to spread cache sets) into a
+ *			single random cycle (Sattolo's algorithm).
+ *//*------------------------------------------------------------------------ */
+static void *tlb_init(const char *params, int *err, tlb_backing backing)
+{
+	static unsigned int seed;
+	struct tlb_state *s;
+	size_t size, stride, n, i, j, line, len;
+	uint32_t *perm, tmp;
+	unsigned int r;
+	char *base;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+	if ((kernel_param_size(params, "size", TLB_DEFAULT_SIZE, &size) != 0) ||
+		(kernel_param_size(params, "stride", TLB_DEFAULT_STRIDE,
+		&stride) != 0) || (stride < TLB_LINE) ||
+		(stride % TLB_LINE != 0) || (size / stride < 2) ||
+		(size / stride > UINT32_MAX)) {
+		*err = -EINVAL;
+		return NULL;
+	}
+	s = calloc(1, sizeof(*s));
+	if (s == NULL) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+	/* Huge page backings: round up and align to PF_HUGE_PAGE */
+	if (backing != TLB_BACKING_4K)
+		size = (size + PF_HUGE_PAGE - 1) & ~(size_t) (PF_HUGE_PAGE - 1);
+	len = size + (backing == TLB_BACKING_THP ? PF_HUGE_PAGE : 0);
+	if (backing == TLB_BACKING_HUGETLB)
+		flags |= MAP_HUGETLB;
+	s->map = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (s->map == MAP_FAILED) {
+		*err = -errno;
+		free(s);
+		return NULL;
+	}
+	s->len = len;
+	base = s->map;
+	if (backing == TLB_BACKING_THP) {
+		base = (char *) (((uintptr_t) s->map + PF_HUGE_PAGE - 1) &
+			~(uintptr_t) (PF_HUGE_PAGE - 1));
+		madvise(base, size, MADV_HUGEPAGE);
+	} else if (backing == TLB_BACKING_4K) {
+		madvise(base, size, MADV_NOHUGEPAGE);
+	}
+
+	n = size / stride;
+	perm = malloc(n * sizeof(*perm));
+	if (perm == NULL) {
+		tlb_deinit(s);
+		*err = -ENOMEM;
+		return NULL;
+	}
+	r = __atomic_add_fetch(&seed, 1, __ATOMIC_RELAXED);
+	for (i = 0; i < n; i++)
+		perm[i] = (uint32_t) i;
+	for (i = n - 1; i > 0; i--) {
+		j = (size_t) rand_r(&r) % i;
+		tmp = perm[i];
+		perm[i] = perm[j];
+		perm[j] = tmp;
+	}
+#define TLB_NODE(k)	((void **) (base + (size_t) (k) * stride + \
+	((size_t) (k) * 7 * TLB_LINE) % stride))
+	line = 0;
+	for (i = 0; i < n; i++) {
+		/* Sattolo: perm is a single cycle 0 -> perm[0] -> ... */
+		*TLB_NODE(line) = TLB_NODE(perm[line]);
+		line = perm[line];
+	}
+	s->cur = TLB_NODE(0);
+#undef TLB_NODE
+	free(perm);
+
+	return s;
+}
+
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		tlb_init_4k
+ * @BRIEF		allocate the TLB kernel state, on 4K pages.
+ * @RETURNS		kernel state, NULL in case of error (err set)
+ * @param[in]		params: size=bytes, stride=bytes
+ * @param[out]		err: see tlb_init()
+ * @DESCRIPTION		allocate the TLB kernel state, on 4K pages.
+ *//*------------------------------------------------------------------------ */
+static void *tlb_init_4k(const char *params, int *err)
+{
+	return tlb_init(params, err, TLB_BACKING_4K);
+}
+
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		tlb_init_thp
+ * @BRIEF		allocate the TLB kernel state, on transparent huge pages.
+ * @RETURNS		kernel state, NULL in case of error (err set)
+ * @param[in]		params: size=bytes, stride=bytes
+ * @param[out]		err: see tlb_init()
+ * @DESCRIPTION		allocate the TLB kernel state, on transparent huge pages.
+ *//*------------------------------------------------------------------------ */
+static void *tlb_init_thp(const char *params, int *err)
+{
+	return tlb_init(params, err, TLB_BACKING_THP);
+}
+
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		tlb_init_hugetlb
+ * @BRIEF		allocate the TLB kernel state, on hugetlbfs pages.
+ * @RETURNS		kernel state, NULL in case of error (err set)
+ * @param[in]		params: size=bytes, stride=bytes
+ * @param[out]		err: see tlb_init()
+ * @DESCRIPTION		allocate the TLB kernel state, on hugetlbfs pages.
+ *//*------------------------------------------------------------------------ */
+static void *tlb_init_hugetlb(const char *params, int *err)
+{
+	return tlb_init(params, err, TLB_BACKING_HUGETLB);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		tlb_run
+ * @BRIEF		run the TLB kernel.
+ * @param[in,out]	state: kernel state
+ * @param[in]		iterations: dependent loads (one per node)
+ * @DESCRIPTION		run the TLB kernel: follow the pointer chase.
+ *//*------------------------------------------------------------------------ */
+static void tlb_run(void *state, unsigned int iterations)
+{
+	struct tlb_state *s = state;
+	void **p = s->cur;
+
+	while (iterations-- > 0)
+		p = (void **) *p;
+	s->cur = p;
+}
+
+
+static const struct kernel kernel_mm[] = {
+	{"pagefault", "", "", "size,page,file",
+		"map, touch and unmap memory (size=,page=4k|2m,file=)",
+		NULL, pf_init, pf_run, pf_deinit, pf_report},
+	{"tlb", "backing=4k", "backing=4k", "size,stride",
+		"random pointer chase (size=,stride=)",
+		NULL, tlb_init_4k, tlb_run, tlb_deinit, NULL},
+	{"tlb", "backing=thp", "backing=4k", "size,stride",
+		"random pointer chase (size=,stride=)",
+		NULL, tlb_init_thp, tlb_run, tlb_deinit, NULL},
+	{"tlb", "backing=hugetlb", "backing=4k", "size,stride",
+		"random pointer chase (size=,stride=)",
+		NULL, tlb_init_hugetlb, tlb_run, tlb_deinit, NULL},
+};
+
+const struct kernel_table kernel_mm_table = {
+	kernel_mm, sizeof(kernel_mm) / sizeof(kernel_mm[0])};
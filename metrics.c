@@ -0,0 +1,403 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			metrics.c
+ * @Description			OpenMetrics exporter on a loopback port
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "cpuloadgen.h"
+#include "clg.h"
+#include "stats.h"
+#include "perfcnt.h"
+#include "verify.h"
+#include "sysfs.h"
+#include "metrics.h"
+
+#define METRICS_POLL_MS		200
+#define METRICS_REQUEST_MAX	2048
+
+
+static int listen_fd = -1;
+static unsigned int metrics_cpu_count;
+static uint64_t metrics_start_ns;
+static pthread_t server;
+static int server_running = 0;
+static int server_stop;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		metrics_family
+ * @BRIEF		write a metric family header.
+ * @param[in,out]	fp: response body stream
+ * @param[in]		name: family name (suffixed with unit, if any)
+ * @param[in]		type: "counter" or "gauge"
+ * @param[in]		unit: unit ("" if none)
+ * @param[in]		help: description
+ * @DESCRIPTION		write a metric family header.
+ *//*------------------------------------------------------------------------ */
+static void metrics_family(FILE *fp, const char *name, const char *type,
+	const char *unit, const char *help)
+{
+	fprintf(fp, "# TYPE %s %s\n", name, type);
+	if (unit[0] != '\0')
+		fprintf(fp, "# UNIT %s %s\n", name, unit);
+	fprintf(fp, "# HELP %s %s\n", name, help);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		metrics_render
+ * @BRIEF		render current metrics in OpenMetrics text format.
+ * @param[in,out]	fp: response body stream
+ * @DESCRIPTION		render current metrics in OpenMetrics text format,
+ *			from a snapshot of the per-thread statistics slots
+ *			(lock-free, load threads are not disturbed).
+ *//*------------------------------------------------------------------------ */
+static void metrics_render(FILE *fp)
+{
+	struct stats_counters *c;
+	struct perfcnt_values *p = NULL;
+	uint64_t *busy, *total, *steal;
+	char path[SYSFS_PATH_MAX];
+	long long khz;
+	double hz;
+	unsigned int i, cpu, e;
+	int load, run;
+
+	c = calloc(metrics_cpu_count, sizeof(struct stats_counters));
+	busy = calloc(metrics_cpu_count, sizeof(uint64_t));
+	total = calloc(metrics_cpu_count, sizeof(uint64_t));
+	steal = calloc(metrics_cpu_count, sizeof(uint64_t));
+	if (perfcnt_enabled())
+		p = calloc(metrics_cpu_count, sizeof(struct perfcnt_values));
+	if ((c == NULL) || (busy == NULL) || (total == NULL) ||
+		(steal == NULL) || (perfcnt_enabled() && (p == NULL)))
+		goto out;
+
+	/* Snapshot first, so that all families are consistent */
+	for (i = 0; i < metrics_cpu_count; i++) {
+		if (__atomic_load_n(&stats_slot_get(i)->load,
+			__ATOMIC_RELAXED) == -1)
+			continue;
+		stats_snapshot(i, &c[i]);
+		if (p != NULL)
+			perfcnt_read(i, &p[i]);
+	}
+	procstat_read(metrics_cpu_count, busy, total, steal);
+	hz = (double) sysconf(_SC_CLK_TCK);
+
+	metrics_family(fp, "cpuloadgen_uptime_seconds", "gauge", "seconds",
+		"Time since load generation started.");
+	fprintf(fp, "cpuloadgen_uptime_seconds %.3f\n",
+		(double) (now_ns() - metrics_start_ns) * 1.0e-9);
+
+#define FOR_EACH_THREAD \
+	for (i = 0; i < metrics_cpu_count; i++) \
+		if ((load = __atomic_load_n(&stats_slot_get(i)->load, \
+			__ATOMIC_RELAXED)) != -1)
+
+	metrics_family(fp, "cpuloadgen_target_load_ratio", "gauge", "ratio",
+		"Requested load of the thread.");
+	FOR_EACH_THREAD
+		if (load != CLG_LOAD_RATE)
+			fprintf(fp, "cpuloadgen_target_load_ratio{thread=\"%u\"} %.2f\n",
+				i, load / 100.0);
+	metrics_family(fp, "cpuloadgen_target_ops", "gauge", "",
+		"1 if the thread has a throughput target, not a load.");
+	FOR_EACH_THREAD
+		fprintf(fp, "cpuloadgen_target_ops{thread=\"%u\"} %d\n",
+			i, load == CLG_LOAD_RATE);
+	metrics_family(fp, "cpuloadgen_frames", "counter", "",
+		"PWM frames completed by the thread.");
+	FOR_EACH_THREAD
+		fprintf(fp, "cpuloadgen_frames_total{thread=\"%u\"} %llu\n",
+			i, (unsigned long long) c[i].frames);
+	metrics_family(fp, "cpuloadgen_busy_seconds", "counter", "seconds",
+		"Time spent running the kernel.");
+	FOR_EACH_THREAD
+		fprintf(fp, "cpuloadgen_busy_seconds_total{thread=\"%u\"} %.9f\n",
+			i, c[i].busy_ns * 1.0e-9);
+	metrics_family(fp, "cpuloadgen_idle_seconds", "counter", "seconds",
+		"Time spent sleeping.");
+	FOR_EACH_THREAD
+		fprintf(fp, "cpuloadgen_idle_seconds_total{thread=\"%u\"} %.9f\n",
+			i, c[i].idle_ns * 1.0e-9);
+	metrics_family(fp, "cpuloadgen_overshoot_seconds", "counter", "seconds",
+		"Sleep time in excess of the requested idle time.");
+	FOR_EACH_THREAD
+		fprintf(fp, "cpuloadgen_overshoot_seconds_total{thread=\"%u\"} %.9f\n",
+			i, c[i].overshoot_ns * 1.0e-9);
+	metrics_family(fp, "cpuloadgen_iterations", "counter", "",
+		"Kernel iterations executed.");
+	FOR_EACH_THREAD
+		fprintf(fp, "cpuloadgen_iterations_total{thread=\"%u\"} %llu\n",
+			i, (unsigned long long) c[i].iterations);
+	metrics_family(fp, "cpuloadgen_thread_cpu", "gauge", "",
+		"CPU the thread last ran on (threads are not pinned).");
+	FOR_EACH_THREAD
+		if ((run = stats_cpu_get(i)) >= 0)
+			fprintf(fp, "cpuloadgen_thread_cpu{thread=\"%u\"} %d\n",
+				i, run);
+
+	for (e = 0; (p != NULL) && (e < PERFCNT_MAX); e++) {
+		fprintf(fp, "# TYPE cpuloadgen_perf_%s counter\n",
+			perfcnt_name(e));
+		FOR_EACH_THREAD
+			if (p[i].valid & (1U << e))
+				fprintf(fp,
+					"cpuloadgen_perf_%s_total{thread=\"%u\"} %llu\n",
+					perfcnt_name(e), i,
+					(unsigned long long) p[i].v[e]);
+	}
+#undef FOR_EACH_THREAD
+
+	metrics_family(fp, "cpuloadgen_cpu_seconds", "counter", "seconds",
+		"CPU time as accounted in /proc/stat.");
+	for (cpu = 0; cpu < metrics_cpu_count; cpu++) {
+		if (total[cpu] == 0)
+			continue;
+		fprintf(fp, "cpuloadgen_cpu_seconds_total{cpu=\"%u\",mode=\"busy\"} %.2f\n",
+			cpu, busy[cpu] / hz);
+		fprintf(fp, "cpuloadgen_cpu_seconds_total{cpu=\"%u\",mode=\"idle\"} %.2f\n",
+			cpu, (total[cpu] - busy[cpu] - steal[cpu]) / hz);
+		fprintf(fp, "cpuloadgen_cpu_seconds_total{cpu=\"%u\",mode=\"steal\"} %.2f\n",
+			cpu, steal[cpu] / hz);
+	}
+	metrics_family(fp, "cpuloadgen_cpu_frequency_hertz", "gauge", "hertz",
+		"Current CPU frequency (scaling_cur_freq).");
+	for (cpu = 0; cpu < metrics_cpu_count; cpu++) {
+		sysfs_path(path, sizeof(path),
+			SYSFS_CPU_PATH "/cpu%u/cpufreq/scaling_cur_freq", cpu);
+		khz = sysfs_read_ll(path);
+		if (khz >= 0)
+			fprintf(fp, "cpuloadgen_cpu_frequency_hertz{cpu=\"%u\"} %lld\n",
+				cpu, khz * 1000);
+	}
+	fprintf(fp, "# EOF\n");
+
+out:
+	free(c);
+	free(p);
+	free(busy);
+	free(total);
+	free(steal);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		metrics_write_all
+ * @BRIEF		write a whole buffer to a socket.
+ * @RETURNS		0 on success, -1 otherwise
+ * @param[in]		fd: socket
+ * @param[in]		buf: data
+ * @param[in]		len: data length
+ * @DESCRIPTION		write a whole buffer to a socket.
+ *//*------------------------------------------------------------------------ */
+static int metrics_write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		n = send(fd, buf, len, MSG_NOSIGNAL);
+		if (n <= 0) {
+			if ((n < 0) && (errno == EINTR))
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		metrics_serve
+ * @BRIEF		serve one HTTP request.
+ * @param[in]		fd: connected socket
+ * @DESCRIPTION		serve one HTTP request: GET /metrics (or /) returns
+ *			the metrics, anything else a 404.
+ *//*------------------------------------------------------------------------ */
+static void metrics_serve(int fd)
+{
+	char req[METRICS_REQUEST_MAX], hdr[256];
+	struct timeval tv = {1, 0};
+	char *body = NULL;
+	size_t body_len = 0, len = 0;
+	FILE *fp;
+	ssize_t n;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	/* Read request headers (body, if any, is ignored) */
+	while (len < sizeof(req) - 1) {
+		n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+		if (n <= 0)
+			break;
+		len += n;
+		req[len] = '\0';
+		if (strstr(req, "\r\n\r\n") != NULL)
+			break;
+	}
+	req[len] = '\0';
+
+	if ((strncmp(req, "GET /metrics ", 13) != 0) &&
+		(strncmp(req, "GET / ", 6) != 0)) {
+		snprintf(hdr, sizeof(hdr),
+			"HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+		metrics_write_all(fd, hdr, strlen(hdr));
+		return;
+	}
+
+	fp = open_memstream(&body, &body_len);
+	if (fp == NULL)
+		return;
+	metrics_render(fp);
+	fclose(fp);
+
+	snprintf(hdr, sizeof(hdr),
+		"HTTP/1.0 200 OK\r\n"
+		"Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+		"Content-Length: %zu\r\nConnection: close\r\n\r\n", body_len);
+	if (metrics_write_all(fd, hdr, strlen(hdr)) == 0)
+		metrics_write_all(fd, body, body_len);
+	free(body);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		metrics_server
+ * @BRIEF		exporter thread.
+ * @param[in]		arg: unused
+ * @DESCRIPTION		exporter thread: accept and serve connections one at
+ *			a time, polling the stop flag periodically.
+ *//*------------------------------------------------------------------------ */
+static void *metrics_server(void *arg UNUSED)
+{
+	struct pollfd pfd;
+	int fd;
+
+	pfd.fd = listen_fd;
+	pfd.events = POLLIN;
+	while (!__atomic_load_n(&server_stop, __ATOMIC_ACQUIRE)) {
+		if (poll(&pfd, 1, METRICS_POLL_MS) <= 0)
+			continue;
+		fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+		metrics_serve(fd);
+		close(fd);
+	}
+
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		metrics_start
+ * @BRIEF		start OpenMetrics exporter on 127.0.0.1.
+ * @RETURNS		0 on success
+ *			-errno in case of socket error
+ *			pthread error code otherwise
+ * @param[in]		count: number of CPU cores
+ * @param[in]		port: TCP port
+ * @DESCRIPTION		start OpenMetrics exporter on 127.0.0.1 (never on
+ *			external interfaces). To be called once load
+ *			threads are started.
+ *//*------------------------------------------------------------------------ */
+int metrics_start(unsigned int count, unsigned int port)
+{
+	struct sockaddr_in addr;
+	int one = 1, ret;
+
+	listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0)
+		return -errno;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if ((bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) ||
+		(listen(listen_fd, 8) != 0)) {
+		ret = -errno;
+		close(listen_fd);
+		listen_fd = -1;
+		return ret;
+	}
+
+	metrics_cpu_count = count;
+	metrics_start_ns = now_ns();
+	server_stop = 0;
+	ret = pthread_create(&server, NULL, metrics_server, NULL);
+	if (ret != 0) {
+		close(listen_fd);
+		listen_fd = -1;
+		return ret;
+	}
+	server_running = 1;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		metrics_stop
+ * @BRIEF		stop OpenMetrics exporter.
+ * @DESCRIPTION		stop OpenMetrics exporter.
+ *//*------------------------------------------------------------------------ */
+void metrics_stop(void)
+{
+	if (!server_running)
+		return;
+	__atomic_store_n(&server_stop, 1, __ATOMIC_RELEASE);
+	pthread_join(server, NULL);
+	close(listen_fd);
+	listen_fd = -1;
+	server_running = 0;
+}
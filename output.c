@@ -0,0 +1,418 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			output.c
+ * @Description			Machine-readable (JSON lines / CSV) output streams
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include "cpuloadgen.h"
+#include "output.h"
+#include "sysfs.h"
+
+#define OUTPUT_BUFFER_SIZE	(64 * 1024)
+#define OUTPUT_LINE_SIZE	4096
+#define OUTPUT_MAX_TYPES	32
+
+
+static output_format format = OUTPUT_NONE;
+static FILE *out_fp = NULL;
+static int info_on_stderr = 0;
+static pthread_mutex_t out_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Record being built, and its CSV column names */
+static char line[OUTPUT_LINE_SIZE];
+static size_t line_len;
+static char keys[OUTPUT_LINE_SIZE];
+static size_t keys_len;
+static unsigned int field_count;
+static const char *record_type;
+
+/* Record types whose CSV header was already written */
+static const char *csv_types[OUTPUT_MAX_TYPES];
+static unsigned int csv_type_count = 0;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_open
+ * @BRIEF		select structured output format and destination.
+ * @RETURNS		0 on success
+ *			-EINVAL in case of unknown format
+ *			-errno in case of failure to open file
+ * @param[in]		fmt: "json" or "csv"
+ * @param[in]		path: output file, NULL or "-" for stdout
+ * @DESCRIPTION		select structured output format and destination.
+ *			Output is fully buffered; it is only written by
+ *			the main and reporter threads, never by load threads.
+ *//*------------------------------------------------------------------------ */
+int output_open(const char *fmt, const char *path)
+{
+	if (strcmp(fmt, "json") == 0)
+		format = OUTPUT_JSON;
+	else if (strcmp(fmt, "csv") == 0)
+		format = OUTPUT_CSV;
+	else
+		return -EINVAL;
+
+	if ((path == NULL) || (strcmp(path, "-") == 0)) {
+		out_fp = stdout;
+		info_on_stderr = 1;
+	} else {
+		out_fp = fopen(path, "w");
+		if (out_fp == NULL) {
+			format = OUTPUT_NONE;
+			return -errno;
+		}
+	}
+	setvbuf(out_fp, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+	output_begin("schema");
+	output_field_str("name", OUTPUT_SCHEMA_NAME);
+	output_field_int("version", OUTPUT_SCHEMA_VERSION);
+	output_end();
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_enabled
+ * @BRIEF		tell whether structured output is enabled.
+ * @RETURNS		1 if enabled, 0 otherwise
+ * @DESCRIPTION		tell whether structured output is enabled.
+ *//*------------------------------------------------------------------------ */
+int output_enabled(void)
+{
+	return format != OUTPUT_NONE;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_on_stdout
+ * @BRIEF		tell whether structured output goes to stdout.
+ * @RETURNS		1 if structured output uses stdout, 0 otherwise
+ * @DESCRIPTION		tell whether structured output goes to stdout.
+ *//*------------------------------------------------------------------------ */
+int output_on_stdout(void)
+{
+	return (format != OUTPUT_NONE) && (out_fp == stdout);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_info_stream
+ * @BRIEF		return stream to be used for informative messages.
+ * @RETURNS		stderr if stdout carries (or carried) structured
+ *			output, stdout otherwise
+ * @DESCRIPTION		return stream to be used for informative messages.
+ *//*------------------------------------------------------------------------ */
+FILE *output_info_stream(void)
+{
+	return info_on_stderr ? stderr : stdout;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_append
+ * @BRIEF		append formatted text to a record buffer.
+ * @param[in,out]	buf: record buffer
+ * @param[in,out]	len: buffer fill level
+ * @param[in]		fmt: printf-like format
+ * @DESCRIPTION		append formatted text to a record buffer.
+ *			Silently truncate if the buffer is full.
+ *//*------------------------------------------------------------------------ */
+static void output_append(char *buf, size_t *len, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+static void output_append(char *buf, size_t *len, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if (*len >= OUTPUT_LINE_SIZE - 1)
+		return;
+	va_start(ap, fmt);
+	n = vsnprintf(buf + *len, OUTPUT_LINE_SIZE - *len, fmt, ap);
+	va_end(ap);
+	if (n > 0)
+		*len += n;
+	if (*len > OUTPUT_LINE_SIZE - 1)
+		*len = OUTPUT_LINE_SIZE - 1;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_key
+ * @BRIEF		start a new field in the record being built.
+ * @param[in]		key: field name
+ * @DESCRIPTION		start a new field in the record being built.
+ *//*------------------------------------------------------------------------ */
+static void output_key(const char *key)
+{
+	if (format == OUTPUT_JSON) {
+		output_append(line, &line_len, ",\"%s\":", key);
+	} else {
+		output_append(line, &line_len, ",");
+		output_append(keys, &keys_len, ",%s", key);
+	}
+	field_count++;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_begin
+ * @BRIEF		start a new record.
+ * @param[in]		type: record type (e.g. "sample")
+ * @DESCRIPTION		start a new record.
+ *			Must be paired with output_end(). Records are
+ *			serialized against each other.
+ *//*------------------------------------------------------------------------ */
+void output_begin(const char *type)
+{
+	if (format == OUTPUT_NONE)
+		return;
+
+	pthread_mutex_lock(&out_mutex);
+	record_type = type;
+	line_len = 0;
+	keys_len = 0;
+	field_count = 0;
+	if (format == OUTPUT_JSON)
+		output_append(line, &line_len, "{\"type\":\"%s\"", type);
+	else
+		output_append(line, &line_len, "%s", type);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_field_int
+ * @BRIEF		add a signed integer field to the record being built.
+ * @param[in]		key: field name
+ * @param[in]		v: field value
+ * @DESCRIPTION		add a signed integer field to the record being built.
+ *//*------------------------------------------------------------------------ */
+void output_field_int(const char *key, long long v)
+{
+	if (format == OUTPUT_NONE)
+		return;
+	output_key(key);
+	output_append(line, &line_len, "%lld", v);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_field_u64
+ * @BRIEF		add an unsigned 64-bit field to the record being built.
+ * @param[in]		key: field name
+ * @param[in]		v: field value
+ * @DESCRIPTION		add an unsigned 64-bit field to the record being built.
+ *//*------------------------------------------------------------------------ */
+void output_field_u64(const char *key, uint64_t v)
+{
+	if (format == OUTPUT_NONE)
+		return;
+	output_key(key);
+	output_append(line, &line_len, "%llu", (unsigned long long) v);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_field_double
+ * @BRIEF		add a floating-point field to the record being built.
+ * @param[in]		key: field name
+ * @param[in]		v: field value
+ * @DESCRIPTION		add a floating-point field to the record being built.
+ *//*------------------------------------------------------------------------ */
+void output_field_double(const char *key, double v)
+{
+	if (format == OUTPUT_NONE)
+		return;
+	output_key(key);
+	if (isfinite(v))
+		output_append(line, &line_len, "%.6g", v);
+	else if (format == OUTPUT_JSON)
+		output_append(line, &line_len, "null");
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_field_null
+ * @BRIEF		add a field without value to the record being built.
+ * @param[in]		key: field name
+ * @DESCRIPTION		add a field without value to the record being built
+ *			(null in JSON, empty in CSV), so that records of a
+ *			type keep the same columns when a value is not
+ *			available.
+ *//*------------------------------------------------------------------------ */
+void output_field_null(const char *key)
+{
+	if (format == OUTPUT_NONE)
+		return;
+	output_key(key);
+	if (format == OUTPUT_JSON)
+		output_append(line, &line_len, "null");
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_field_str
+ * @BRIEF		add a string field to the record being built.
+ * @param[in]		key: field name
+ * @param[in]		s: field value
+ * @DESCRIPTION		add a string field to the record being built.
+ *			Escaped as needed by the selected format.
+ *//*------------------------------------------------------------------------ */
+void output_field_str(const char *key, const char *s)
+{
+	if (format == OUTPUT_NONE)
+		return;
+	output_key(key);
+	output_append(line, &line_len, "\"");
+	for (; *s != '\0'; s++) {
+		if ((*s == '"') && (format == OUTPUT_CSV))
+			output_append(line, &line_len, "\"\"");
+		else if (((*s == '"') || (*s == '\\')) &&
+			(format == OUTPUT_JSON))
+			output_append(line, &line_len, "\\%c", *s);
+		else if ((unsigned char) *s < 0x20)
+			output_append(line, &line_len, format == OUTPUT_JSON ?
+				"\\u%04x" : " ", (unsigned char) *s);
+		else
+			output_append(line, &line_len, "%c", *s);
+	}
+	output_append(line, &line_len, "\"");
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_end
+ * @BRIEF		complete and emit the record being built.
+ * @DESCRIPTION		complete and emit the record being built.
+ *			In CSV format, the first record of each type is
+ *			preceded by a "#<type>,<columns>" header line.
+ *//*------------------------------------------------------------------------ */
+void output_end(void)
+{
+	unsigned int i;
+
+	if (format == OUTPUT_NONE)
+		return;
+
+	if (format == OUTPUT_JSON) {
+		fprintf(out_fp, "%s}\n", line);
+	} else {
+		for (i = 0; i < csv_type_count; i++)
+			if (strcmp(csv_types[i], record_type) == 0)
+				break;
+		if (i == csv_type_count) {
+			fprintf(out_fp, "#%s%s\n", record_type, keys);
+			if (csv_type_count < OUTPUT_MAX_TYPES)
+				csv_types[csv_type_count++] = record_type;
+		}
+		fprintf(out_fp, "%s\n", line);
+	}
+	pthread_mutex_unlock(&out_mutex);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_topology
+ * @BRIEF		emit one "topology" record per CPU.
+ * @param[in]		cpu_count: number of CPU cores
+ * @DESCRIPTION		emit one "topology" record per CPU, with package
+ *			and core IDs as reported by sysfs (-1 if unknown).
+ *//*------------------------------------------------------------------------ */
+void output_topology(unsigned int cpu_count)
+{
+	char path[SYSFS_PATH_MAX];
+	unsigned int cpu;
+
+	if (format == OUTPUT_NONE)
+		return;
+
+	for (cpu = 0; cpu < cpu_count; cpu++) {
+		output_begin("topology");
+		output_field_int("cpu", cpu);
+		sysfs_path(path, sizeof(path),
+			SYSFS_CPU_PATH "/cpu%u/topology/physical_package_id",
+			cpu);
+		output_field_int("package", sysfs_read_ll(path));
+		sysfs_path(path, sizeof(path),
+			SYSFS_CPU_PATH "/cpu%u/topology/core_id", cpu);
+		output_field_int("core", sysfs_read_ll(path));
+		output_end();
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_flush
+ * @BRIEF		flush structured output buffer.
+ * @DESCRIPTION		flush structured output buffer.
+ *//*------------------------------------------------------------------------ */
+void output_flush(void)
+{
+	if (format == OUTPUT_NONE)
+		return;
+	pthread_mutex_lock(&out_mutex);
+	fflush(out_fp);
+	pthread_mutex_unlock(&out_mutex);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		output_close
+ * @BRIEF		flush and close structured output.
+ * @DESCRIPTION		flush and close structured output.
+ *//*------------------------------------------------------------------------ */
+void output_close(void)
+{
+	if (format == OUTPUT_NONE)
+		return;
+	if (out_fp == stdout)
+		fflush(out_fp);
+	else
+		fclose(out_fp);
+	out_fp = NULL;
+	format = OUTPUT_NONE;
+}
@@ -0,0 +1,86 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			output.h
+ * @Description			Machine-readable (JSON lines / CSV) output streams
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Schema version of structured output. Bump whenever a record type or
+ * field is renamed or removed (adding fields is backward compatible).
+ */
+#define OUTPUT_SCHEMA_NAME	"cpuloadgen"
+#define OUTPUT_SCHEMA_VERSION	1
+
+typedef enum {
+	OUTPUT_NONE,
+	OUTPUT_JSON,
+	OUTPUT_CSV
+} output_format;
+
+
+int output_open(const char *format, const char *path);
+int output_enabled(void);
+int output_on_stdout(void);
+FILE *output_info_stream(void);
+
+void output_begin(const char *type);
+void output_field_int(const char *key, long long v);
+void output_field_u64(const char *key, uint64_t v);
+void output_field_double(const char *key, double v);
+void output_field_str(const char *key, const char *s);
+void output_field_null(const char *key);
+void output_end(void);
+
+void output_topology(unsigned int cpu_count);
+void output_flush(void);
+void output_close(void);
+
+/* Informative (human-readable) messages, kept off stdout when it is used
+ * for structured output */
+#define iprintf(format, ...) \
+	fprintf(output_info_stream(), format, ## __VA_ARGS__)
+
+
+#endif
@@ -0,0 +1,366 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			overhead.c
+ * @Description			Load engine self-overhead benchmark
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "cpuloadgen.h"
+#include "clg_ops.h"
+#include "stats.h"
+#include "trace.h"
+#include "histogram.h"
+#include "output.h"
+#include "overhead.h"
+
+
+#define OVERHEAD_TRACE_EVENTS	(1 << 16)
+
+static const long int overhead_periods[] = {0, 500, 1000, 2000, 5000, 10000};
+#define OVERHEAD_PERIODS	(sizeof(overhead_periods) / \
+	sizeof(overhead_periods[0]))
+
+/*
+ * Instrumentation enabled in a measurement. Each one is measured on its own
+ * against the base, so that small costs are not lost in clock read noise.
+ */
+typedef enum {
+	OVERHEAD_BASE,		/* simulated clock, no telemetry */
+	OVERHEAD_CLOCK,		/* real clock reads */
+	OVERHEAD_TRACE,		/* trace events */
+	OVERHEAD_HIST,		/* controller error histograms */
+	OVERHEAD_CONFIGS
+} overhead_config;
+
+/*
+ * Controllers run on simulated time: work and sleep cost nothing but
+ * advance the clock, so that the real time a frame takes is the engine's
+ * own bookkeeping. When enabled, every clock read also reads the real
+ * clock, to account for its cost.
+ */
+struct overhead_clock {
+	uint64_t now;
+	uint64_t reads;
+	int real;
+};
+
+static volatile uint64_t overhead_sink;
+static struct stats_slot overhead_slot;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		overhead_now
+ * @BRIEF		return simulated time.
+ * @RETURNS		simulated time (ns)
+ * @param[in,out]	priv: simulated clock
+ * @DESCRIPTION		return simulated time, reading the real clock too if
+ *			enabled.
+ *//*------------------------------------------------------------------------ */
+static uint64_t overhead_now(void *priv)
+{
+	struct overhead_clock *c = priv;
+
+	c->reads++;
+	if (c->real)
+		overhead_sink = now_ns();
+	return c->now;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		overhead_work
+ * @BRIEF		advance simulated time by some kernel iterations.
+ * @param[in,out]	priv: simulated clock
+ * @param[in]		iterations: number of kernel iterations
+ * @DESCRIPTION		advance simulated time by some kernel iterations.
+ *//*------------------------------------------------------------------------ */
+static void overhead_work(void *priv, unsigned int iterations)
+{
+	struct overhead_clock *c = priv;
+
+	c->now += (uint64_t) (iterations * CLG_ITERATION_NS);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		overhead_sleep
+ * @BRIEF		advance simulated time by a relative sleep.
+ * @param[in,out]	priv: simulated clock
+ * @param[in]		ns: sleep time
+ * @DESCRIPTION		advance simulated time by a relative sleep.
+ *//*------------------------------------------------------------------------ */
+static void overhead_sleep(void *priv, uint64_t ns)
+{
+	struct overhead_clock *c = priv;
+
+	c->now += ns;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		overhead_sleep_until
+ * @BRIEF		advance simulated time up to a deadline.
+ * @param[in,out]	priv: simulated clock
+ * @param[in]		deadline_ns: absolute deadline
+ * @DESCRIPTION		advance simulated time up to a deadline.
+ *//*------------------------------------------------------------------------ */
+static void overhead_sleep_until(void *priv, uint64_t deadline_ns)
+{
+	struct overhead_clock *c = priv;
+
+	if (deadline_ns > c->now)
+		c->now = deadline_ns;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		overhead_stats_ns
+ * @BRIEF		measure the cost of publishing counters.
+ * @RETURNS		stats_publish() cost, in ns
+ * @DESCRIPTION		measure the cost of publishing counters (best of
+ *			OVERHEAD_ROUNDS runs of 1M calls).
+ *//*------------------------------------------------------------------------ */
+static double overhead_stats_ns(void)
+{
+	struct stats_counters c;
+	uint64_t start, elapsed, best = UINT64_MAX;
+	unsigned int r, i;
+
+	memset(&c, 0, sizeof(c));
+	for (r = 0; r < OVERHEAD_ROUNDS; r++) {
+		start = now_ns();
+		for (i = 0; i < 1000000; i++) {
+			c.frames++;
+			stats_publish(&overhead_slot, &c);
+		}
+		elapsed = now_ns() - start;
+		if (elapsed < best)
+			best = elapsed;
+	}
+
+	return best / 1000000.0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		overhead_measure
+ * @BRIEF		measure the real time per frame of a controller.
+ * @RETURNS		0 on success, -ENOMEM in case of error
+ * @param[in]		period: controller frame period (us, 0: legacy)
+ * @param[in]		config: instrumentation enabled
+ * @param[in]		ring: trace ring
+ * @param[in]		h: controller error histograms
+ * @param[out]		frame_ns: real time per frame (ns)
+ * @param[out]		target_ns: simulated time per frame (ns)
+ * @param[out]		reads: clock reads per frame
+ * @DESCRIPTION		measure the real time per frame of a controller, best
+ *			of OVERHEAD_ROUNDS runs of at least OVERHEAD_RUN_NS.
+ *			Each frame is followed by the stop flag and duration
+ *			checks of the engine thread loop.
+ *//*------------------------------------------------------------------------ */
+static int overhead_measure(long int period, overhead_config config,
+	struct trace_ring *ring, struct histogram **h, double *frame_ns,
+	double *target_ns, double *reads)
+{
+	struct overhead_clock clk;
+	struct clg_ops ops = {overhead_now, overhead_work, overhead_sleep,
+		overhead_sleep_until, &clk};
+	struct clg_thread *t;
+	struct clg_counters c;
+	uint64_t start, elapsed, frames, start_ns, sim_ns;
+	/* Never set: only there to be checked like the engine does */
+	static volatile int stop;
+	static volatile uint64_t duration_ns;
+	unsigned int r;
+	double ns;
+
+	*frame_ns = HUGE_VAL;
+	for (r = 0; r < OVERHEAD_ROUNDS; r++) {
+		memset(&clk, 0, sizeof(clk));
+		clk.now = NSEC_PER_SEC;
+		clk.real = (config == OVERHEAD_CLOCK);
+		t = clg_thread_new(&ops, OVERHEAD_LOAD, period);
+		if (t == NULL)
+			return -ENOMEM;
+		clg_thread_instrument(t,
+			(config == OVERHEAD_TRACE) ? ring : NULL,
+			(config == OVERHEAD_HIST) ? h[HIST_FRAME_ERROR] : NULL,
+			(config == OVERHEAD_HIST) ? h[HIST_BUSY_ERROR] : NULL,
+			(config == OVERHEAD_HIST) ? h[HIST_IDLE_OVERSLEEP] : NULL);
+
+		start_ns = clk.now;
+		frames = 0;
+		elapsed = 0;
+		start = now_ns();
+		/* Real time is only checked every 256 frames */
+		while (elapsed < OVERHEAD_RUN_NS) {
+			clg_thread_frame(t);
+			sim_ns = overhead_now(&clk) - start_ns;
+			if (__atomic_load_n(&stop, __ATOMIC_RELAXED) ||
+				((duration_ns != 0) && (sim_ns >= duration_ns)))
+				break;
+			if ((++frames & 255) == 0)
+				elapsed = now_ns() - start;
+		}
+
+		ns = (double) elapsed / frames;
+		if (ns < *frame_ns) {
+			*frame_ns = ns;
+			clg_thread_counters(t, &c);
+			*target_ns = (double) (clk.now - start_ns) / c.frames;
+			*reads = (double) clk.reads / c.frames;
+		}
+		clg_thread_free(t);
+	}
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		overhead_run
+ * @BRIEF		run the load engine self-overhead benchmark.
+ * @RETURNS		number of controllers over budget (>= 0),
+ *			negative error code otherwise
+ * @param[in]		period: controller to measure (us, 0: legacy,
+ *			-1: all)
+ * @DESCRIPTION		run the load engine self-overhead benchmark: measure
+ *			the real time each controller spends per frame on
+ *			clock reads, control (frame bookkeeping, load and
+ *			stop checks), stats publishing, tracing and
+ *			histograms, while kernel work and sleeps are
+ *			simulated. Print and record it per frame and as a
+ *			percentage of the target frame length.
+ *//*------------------------------------------------------------------------ */
+int overhead_run(long int period)
+{
+	struct histogram *h[HIST_KIND_MAX];
+	struct trace_header *hdr;
+	struct trace_ring ring;
+	double frame_ns[OVERHEAD_CONFIGS], target_ns = 0.0, reads = 0.0;
+	double stats_ns, cost[OVERHEAD_CONFIGS], control_ns, total_ns, pct;
+	unsigned int i, j, over = 0;
+	size_t size;
+	char name[24];
+	int ret = 0;
+
+	/* In-memory ring and histograms: no file I/O in measurements */
+	size = sizeof(*hdr) + OVERHEAD_TRACE_EVENTS * sizeof(struct trace_event);
+	hdr = calloc(1, size);
+	for (i = 0; i < HIST_KIND_MAX; i++)
+		h[i] = calloc(1, sizeof(struct histogram));
+	if ((hdr == NULL) || (h[0] == NULL) || (h[1] == NULL) ||
+		(h[2] == NULL)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	memset(&ring, 0, sizeof(ring));
+	ring.hdr = hdr;
+	ring.ev = (struct trace_event *) (hdr + 1);
+	ring.mask = OVERHEAD_TRACE_EVENTS - 1;
+	ring.fd = -1;
+
+	stats_ns = overhead_stats_ns();
+	iprintf("Measuring load engine overhead at %d%% load (budget %.1f%% of frame)...\n",
+		OVERHEAD_LOAD, OVERHEAD_BUDGET);
+	iprintf("\n\t%-8s %9s %7s %9s %9s %9s %9s %9s %9s %8s\n", "period",
+		"frame", "clock", "clock", "control", "stats", "trace",
+		"histogram", "total", "total");
+	iprintf("\t%-8s %9s %7s %9s %9s %9s %9s %9s %9s %8s\n", "",
+		"(us)", "reads", "(ns)", "(ns)", "(ns)", "(ns)", "(ns)",
+		"(ns)", "(%)");
+	for (j = 0; j < OVERHEAD_PERIODS; j++) {
+		if ((period >= 0) && (overhead_periods[j] != period))
+			continue;
+		for (i = 0; i < OVERHEAD_CONFIGS; i++) {
+			ret = overhead_measure(overhead_periods[j], i, &ring, h,
+				&frame_ns[i], &target_ns, &reads);
+			if (ret != 0)
+				goto out;
+			/* Cost of each instrumentation, noise clamped */
+			cost[i] = (i == 0) ? frame_ns[0] :
+				frame_ns[i] - frame_ns[0];
+			if (cost[i] < 0.0)
+				cost[i] = 0.0;
+		}
+		control_ns = cost[OVERHEAD_BASE] > stats_ns ?
+			cost[OVERHEAD_BASE] - stats_ns : 0.0;
+		total_ns = control_ns + stats_ns + cost[OVERHEAD_CLOCK] +
+			cost[OVERHEAD_TRACE] + cost[OVERHEAD_HIST];
+		pct = total_ns * 100.0 / target_ns;
+		over += (pct > OVERHEAD_BUDGET);
+
+		if (overhead_periods[j] == 0)
+			snprintf(name, sizeof(name), "legacy");
+		else
+			snprintf(name, sizeof(name), "%ldus",
+				overhead_periods[j]);
+		iprintf("\t%-8s %9.1f %7.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %7.3f%%%s\n",
+			name, target_ns / 1000.0, reads, cost[OVERHEAD_CLOCK],
+			control_ns, stats_ns, cost[OVERHEAD_TRACE],
+			cost[OVERHEAD_HIST], total_ns, pct,
+			pct > OVERHEAD_BUDGET ? " OVER BUDGET" : "");
+
+		output_begin("overhead");
+		output_field_int("period", overhead_periods[j]);
+		output_field_int("load", OVERHEAD_LOAD);
+		output_field_double("frame_ns", target_ns);
+		output_field_double("clock_reads", reads);
+		output_field_double("clock_ns", cost[OVERHEAD_CLOCK]);
+		output_field_double("control_ns", control_ns);
+		output_field_double("stats_ns", stats_ns);
+		output_field_double("trace_ns", cost[OVERHEAD_TRACE]);
+		output_field_double("histogram_ns", cost[OVERHEAD_HIST]);
+		output_field_double("total_ns", total_ns);
+		output_field_double("pct", pct);
+		output_field_int("pass", pct <= OVERHEAD_BUDGET);
+		output_end();
+	}
+	ret = over;
+
+out:
+	free(hdr);
+	for (i = 0; i < HIST_KIND_MAX; i++)
+		free(h[i]);
+	return ret;
+}
@@ -0,0 +1,358 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			perfcnt.c
+ * @Description			Per-thread performance counters (perf_event_open)
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "cpuloadgen.h"
+#include "output.h"
+#include "perfcnt.h"
+
+#define PERFCNT_GROUP_HW	0
+#define PERFCNT_GROUP_TLB	1
+#define PERFCNT_GROUP_SW	2
+#define PERFCNT_GROUPS		3
+
+
+struct perfcnt_group {
+	int fd[PERFCNT_MAX];	/* fd[0] is the group leader */
+	perfcnt_id id[PERFCNT_MAX];
+	unsigned int nr;
+};
+
+struct perfcnt_thread {
+	struct perfcnt_group group[PERFCNT_GROUPS];
+};
+
+static const struct {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+	int group;
+} perfcnt_events[PERFCNT_MAX] = {
+	[PERFCNT_CYCLES] = {"cycles",
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,
+		PERFCNT_GROUP_HW},
+	[PERFCNT_INSTRUCTIONS] = {"instructions",
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,
+		PERFCNT_GROUP_HW},
+	[PERFCNT_CACHE_REFS] = {"cache_references",
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES,
+		PERFCNT_GROUP_HW},
+	[PERFCNT_CACHE_MISSES] = {"cache_misses",
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,
+		PERFCNT_GROUP_HW},
+	[PERFCNT_BRANCH_MISSES] = {"branch_misses",
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,
+		PERFCNT_GROUP_HW},
+	[PERFCNT_DTLB_MISSES] = {"dtlb_load_misses",
+		PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERFCNT_GROUP_TLB},
+	[PERFCNT_TASK_CLOCK] = {"task_clock_ns",
+		PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK,
+		PERFCNT_GROUP_SW},
+	[PERFCNT_CTX_SWITCHES] = {"context_switches",
+		PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES,
+		PERFCNT_GROUP_SW},
+	[PERFCNT_MIGRATIONS] = {"cpu_migrations",
+		PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS,
+		PERFCNT_GROUP_SW},
+	[PERFCNT_PAGE_FAULTS] = {"page_faults",
+		PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS,
+		PERFCNT_GROUP_SW},
+	[PERFCNT_MAJOR_FAULTS] = {"major_faults",
+		PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ,
+		PERFCNT_GROUP_SW},
+};
+
+static struct perfcnt_thread *perf_threads = NULL;
+static unsigned int perf_count = 0;
+static int hw_warned = 0;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		perf_event_open
+ * @BRIEF		perf_event_open() syscall wrapper (no libc wrapper).
+ * @RETURNS		file descriptor, -1 in case of error (errno set)
+ * @DESCRIPTION		perf_event_open() syscall wrapper (no libc wrapper).
+ *//*------------------------------------------------------------------------ */
+static int perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu,
+	int group_fd, unsigned long flags)
+{
+	return (int) syscall(__NR_perf_event_open, attr, pid, cpu, group_fd,
+		flags);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		perfcnt_init
+ * @BRIEF		enable per-thread performance counters.
+ * @RETURNS		0 on success
+ *			-ENOMEM in case of allocation failure
+ * @param[in]		count: number of CPU cores
+ * @DESCRIPTION		enable per-thread performance counters.
+ *			Counters are opened later by each load thread.
+ *//*------------------------------------------------------------------------ */
+int perfcnt_init(unsigned int count)
+{
+	unsigned int i, g, e;
+
+	perf_threads = calloc(count, sizeof(struct perfcnt_thread));
+	if (perf_threads == NULL)
+		return -ENOMEM;
+	for (i = 0; i < count; i++)
+		for (g = 0; g < PERFCNT_GROUPS; g++)
+			for (e = 0; e < PERFCNT_MAX; e++)
+				perf_threads[i].group[g].fd[e] = -1;
+	perf_count = count;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		perfcnt_enabled
+ * @BRIEF		tell whether performance counters are enabled.
+ * @RETURNS		1 if enabled, 0 otherwise
+ * @DESCRIPTION		tell whether performance counters are enabled.
+ *//*------------------------------------------------------------------------ */
+int perfcnt_enabled(void)
+{
+	return perf_threads != NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		perfcnt_group_open
+ * @BRIEF		open one counter group for the calling thread.
+ * @RETURNS		0 if at least the group leader could be opened
+ *			-errno otherwise
+ * @param[in,out]	grp: group to open
+ * @param[in]		group: PERFCNT_GROUP_HW, PERFCNT_GROUP_TLB or
+ *			PERFCNT_GROUP_SW
+ * @DESCRIPTION		open one counter group for the calling thread.
+ *			User-space only counting is retried if the kernel
+ *			refuses to count kernel events (perf_event_paranoid).
+ *			Members that fail to open are skipped.
+ *//*------------------------------------------------------------------------ */
+static int perfcnt_group_open(struct perfcnt_group *grp, int group)
+{
+	struct perf_event_attr attr;
+	int exclude_kernel, fd;
+	unsigned int e;
+
+	for (exclude_kernel = 0; exclude_kernel <= 1; exclude_kernel++) {
+		grp->nr = 0;
+		for (e = 0; e < PERFCNT_MAX; e++) {
+			if (perfcnt_events[e].group != group)
+				continue;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = perfcnt_events[e].type;
+			attr.config = perfcnt_events[e].config;
+			attr.read_format = PERF_FORMAT_GROUP |
+				PERF_FORMAT_TOTAL_TIME_ENABLED |
+				PERF_FORMAT_TOTAL_TIME_RUNNING;
+			attr.exclude_kernel = exclude_kernel;
+			attr.exclude_hv = 1;
+			attr.disabled = (grp->nr == 0);
+			fd = perf_event_open(&attr, 0, -1,
+				grp->nr == 0 ? -1 : grp->fd[0], 0);
+			if (fd < 0) {
+				if (grp->nr == 0)
+					break;
+				continue;
+			}
+			grp->fd[grp->nr] = fd;
+			grp->id[grp->nr] = e;
+			grp->nr++;
+		}
+		if (grp->nr != 0)
+			break;
+		if (errno != EACCES)
+			return -errno;
+	}
+	if (grp->nr == 0)
+		return -errno;
+
+	ioctl(grp->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(grp->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		perfcnt_thread_open
+ * @BRIEF		open performance counters for the calling thread.
+ * @RETURNS		0 on success
+ *			-ENODEV if not even software counters are available
+ *			-EINVAL in case of invalid cpu
+ * @param[in]		cpu: CPU core ID the calling thread loads
+ * @DESCRIPTION		open performance counters for the calling thread.
+ *			To be called by each load thread before entering its
+ *			loop. Hardware counters are optional: when no PMU
+ *			is available (e.g. in a VM), only software events
+ *			are counted.
+ *//*------------------------------------------------------------------------ */
+int perfcnt_thread_open(unsigned int cpu)
+{
+	struct perfcnt_thread *t;
+	int ret;
+
+	if ((perf_threads == NULL) || (cpu >= perf_count))
+		return -EINVAL;
+	t = &perf_threads[cpu];
+
+	ret = perfcnt_group_open(&t->group[PERFCNT_GROUP_HW],
+		PERFCNT_GROUP_HW);
+	if ((ret != 0) &&
+		!__atomic_exchange_n(&hw_warned, 1, __ATOMIC_RELAXED))
+		fprintf(stderr,
+			"cpuloadgen: hardware counters unavailable (%d), using software events only.\n",
+			ret);
+	/*
+	 * The dTLB cache event is counted on its own: added to the hardware
+	 * group, it would exceed the general-purpose counters of small PMUs
+	 * and leave the whole group unschedulable. Failure is silent, as not
+	 * all PMUs expose it.
+	 */
+	perfcnt_group_open(&t->group[PERFCNT_GROUP_TLB], PERFCNT_GROUP_TLB);
+	ret = perfcnt_group_open(&t->group[PERFCNT_GROUP_SW],
+		PERFCNT_GROUP_SW);
+	if ((ret != 0) && (t->group[PERFCNT_GROUP_HW].nr == 0)) {
+		fprintf(stderr,
+			"cpuloadgen: CPU%u: could not open any counter! (%d)\n",
+			cpu, ret);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		perfcnt_read
+ * @BRIEF		read the counters of a load thread.
+ * @RETURNS		0 on success
+ *			-ENODEV if the thread has no counter open
+ * @param[in]		cpu: CPU core ID
+ * @param[out]		vals: counter values, scaled if multiplexed
+ * @DESCRIPTION		read the counters of a load thread.
+ *			May be called from any thread (typically the
+ *			reporter): reading a counter group does not
+ *			interrupt the thread being measured.
+ *//*------------------------------------------------------------------------ */
+int perfcnt_read(unsigned int cpu, struct perfcnt_values *vals)
+{
+	struct perfcnt_group *grp;
+	uint64_t buf[3 + PERFCNT_MAX];
+	unsigned int g, i;
+	double scale;
+	ssize_t n;
+
+	memset(vals, 0, sizeof(*vals));
+	if ((perf_threads == NULL) || (cpu >= perf_count))
+		return -ENODEV;
+
+	for (g = 0; g < PERFCNT_GROUPS; g++) {
+		grp = &perf_threads[cpu].group[g];
+		if (grp->nr == 0)
+			continue;
+		n = read(grp->fd[0], buf, sizeof(buf));
+		if ((n < (ssize_t) (3 * sizeof(uint64_t))) || (buf[0] != grp->nr))
+			continue;
+		/* buf: nr, time_enabled, time_running, values[nr] */
+		if (buf[2] == 0)
+			/* never scheduled on the PMU: no data, not zero */
+			continue;
+		scale = (double) buf[1] / (double) buf[2];
+		for (i = 0; i < grp->nr; i++) {
+			vals->v[grp->id[i]] = (uint64_t) ((double) buf[3 + i] *
+				scale);
+			vals->valid |= 1U << grp->id[i];
+		}
+	}
+
+	return vals->valid ? 0 : -ENODEV;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		perfcnt_name
+ * @BRIEF		return counter name.
+ * @RETURNS		counter name
+ * @param[in]		id: counter ID
+ * @DESCRIPTION		return counter name (as used in structured output).
+ *//*------------------------------------------------------------------------ */
+const char *perfcnt_name(perfcnt_id id)
+{
+	return perfcnt_events[id].name;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		perfcnt_deinit
+ * @BRIEF		close all counters.
+ * @DESCRIPTION		close all counters.
+ *			Must not be called while the reporter is running.
+ *//*------------------------------------------------------------------------ */
+void perfcnt_deinit(void)
+{
+	unsigned int i, g, e;
+
+	if (perf_threads == NULL)
+		return;
+	for (i = 0; i < perf_count; i++)
+		for (g = 0; g < PERFCNT_GROUPS; g++)
+			for (e = 0; e < perf_threads[i].group[g].nr; e++)
+				close(perf_threads[i].group[g].fd[e]);
+	free(perf_threads);
+	perf_threads = NULL;
+	perf_count = 0;
+}
@@ -0,0 +1,79 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			perfcnt.h
+ * @Description			Per-thread performance counters (perf_event_open)
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __PERFCNT_H__
+#define __PERFCNT_H__
+
+#include <stdint.h>
+
+typedef enum {
+	/* Hardware group (requires a PMU) */
+	PERFCNT_CYCLES,
+	PERFCNT_INSTRUCTIONS,
+	PERFCNT_CACHE_REFS,
+	PERFCNT_CACHE_MISSES,
+	PERFCNT_BRANCH_MISSES,
+	PERFCNT_DTLB_MISSES,
+	/* Software group (always attempted) */
+	PERFCNT_TASK_CLOCK,
+	PERFCNT_CTX_SWITCHES,
+	PERFCNT_MIGRATIONS,
+	PERFCNT_PAGE_FAULTS,
+	PERFCNT_MAJOR_FAULTS,
+	PERFCNT_MAX
+} perfcnt_id;
+
+struct perfcnt_values {
+	uint64_t v[PERFCNT_MAX];
+	uint32_t valid; /* bitmask of (1 << perfcnt_id) */
+};
+
+
+int perfcnt_init(unsigned int count);
+int perfcnt_enabled(void);
+int perfcnt_thread_open(unsigned int cpu);
+int perfcnt_read(unsigned int cpu, struct perfcnt_values *vals);
+const char *perfcnt_name(perfcnt_id id);
+void perfcnt_deinit(void);
+
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			probes.h
+ * @Description			Static (USDT/SDT) tracepoints
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __PROBES_H__
+#define __PROBES_H__
+
+/*
+ * Static tracepoints at load thread frame boundaries, usable with any SDT
+ * aware tracer (perf probe sdt_cpuloadgen:*, bpftrace usdt:..., SystemTap).
+ * With <sys/sdt.h>, a probe site is a single nop plus an ELF note: it costs
+ * nothing while no tracer is attached, and arguments are read from registers
+ * or stack by the tracer. Without <sys/sdt.h> (or with -DCPULOADGEN_NO_SDT),
+ * probes compile to nothing (the Makefile warns about the former).
+ *
+ * Probes (all times in ns, CLOCK_MONOTONIC):
+ *	thread_start(cpu, load, start_ns)
+ *	frame_start(cpu, frame, busy_start_ns)
+ *	busy_end(cpu, frame, busy_ns, iterations)
+ *	idle_end(cpu, frame, idle_ns, idle_req_ns)
+ *	frame_end(cpu, frame, load, elapsed_ns)
+ *	thread_stop(cpu, frames)
+ */
+#if !defined(CPULOADGEN_NO_SDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define CPULOADGEN_SDT
+#endif
+#endif
+
+#ifdef CPULOADGEN_SDT
+#define PROBE2(name, a, b) \
+	DTRACE_PROBE2(cpuloadgen, name, a, b)
+#define PROBE3(name, a, b, c) \
+	DTRACE_PROBE3(cpuloadgen, name, a, b, c)
+#define PROBE4(name, a, b, c, d) \
+	DTRACE_PROBE4(cpuloadgen, name, a, b, c, d)
+#else
+#define PROBE2(name, a, b) \
+	do { (void) (a); (void) (b); } while (0)
+#define PROBE3(name, a, b, c) \
+	do { (void) (a); (void) (b); (void) (c); } while (0)
+#define PROBE4(name, a, b, c, d) \
+	do { (void) (a); (void) (b); (void) (c); (void) (d); } while (0)
+#endif
+
+
+#endif
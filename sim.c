@@ -0,0 +1,431 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			sim.c
+ * @Description			Deterministic controller simulator
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "cpuloadgen.h"
+#include "clg_ops.h"
+#include "output.h"
+#include "steal.h"
+#include "sim.h"
+
+
+#define SIM_WINDOWS	(SIM_DURATION_NS / SIM_WINDOW_NS)
+#define SIM_START_NS	NSEC_PER_SEC	/* simulated clock origin */
+
+static const long int sim_periods[] = {0, 500, 1000, 2000, 5000, 10000};
+#define SIM_PERIODS	(sizeof(sim_periods) / sizeof(sim_periods[0]))
+
+static const double sim_steps[] = {0.5, 0.8, 1.25, 2.0};
+#define SIM_STEPS	(sizeof(sim_steps) / sizeof(sim_steps[0]))
+
+/* One scenario in SIM_COMPENSATED runs near 100% under steal compensation */
+#define SIM_COMPENSATED	8
+
+/* Simulated machine, as seen by one load thread */
+struct sim {
+	uint64_t t;		/* simulated time, ns */
+	uint64_t cpu_ns;	/* time spent running (excluding preemption) */
+	uint64_t rng;		/* random generator state */
+	double iter_ns;		/* kernel iteration time at initial speed */
+	double step_speed;	/* speed factor after frequency step */
+	double share;		/* share of running time delivered (steal) */
+	double preempt_rate;	/* preemptions per second of running time */
+	uint64_t preempt_ns;	/* max preemption length */
+	uint64_t slack_ns;	/* timer slack */
+	uint64_t jitter_ns;	/* max additional wakeup latency */
+	uint64_t clock_ns;	/* cost of a clock read */
+	int runaway;		/* a sleep request outlasted the scenario */
+};
+
+/* Scenario parameters and results */
+struct sim_result {
+	int load;
+	long int period;
+	double share;		/* delivered time share, 1.0: no steal */
+	double err_pre;		/* mean load error before step (%) */
+	double err_post;	/* mean load error after step (%) */
+	long int converge_ms;	/* time to converge after step (end of the
+				   first window within tolerance), -1: never */
+	int pass;
+};
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sim_rand
+ * @BRIEF		return a uniformly distributed random number.
+ * @RETURNS		random number in [0 .. 1[
+ * @param[in,out]	s: simulated machine
+ * @DESCRIPTION		return a uniformly distributed random number, from
+ *			the scenario's own generator (splitmix64), so that
+ *			scenarios are reproducible and independent.
+ *//*------------------------------------------------------------------------ */
+static double sim_rand(struct sim *s)
+{
+	uint64_t z = (s->rng += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	z ^= z >> 31;
+	return (double) (z >> 11) / (double) (1ULL << 53);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sim_now
+ * @BRIEF		read the simulated clock.
+ * @RETURNS		simulated time, in ns
+ * @param[in,out]	priv: simulated machine
+ * @DESCRIPTION		read the simulated clock. A read costs clock_ns.
+ *//*------------------------------------------------------------------------ */
+static uint64_t sim_now(void *priv)
+{
+	struct sim *s = priv;
+
+	s->t += s->clock_ns;
+	s->cpu_ns += s->clock_ns;
+	return s->t;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sim_work
+ * @BRIEF		run kernel iterations on the simulated CPU.
+ * @param[in,out]	priv: simulated machine
+ * @param[in]		iterations: number of kernel iterations
+ * @DESCRIPTION		run kernel iterations on the simulated CPU, at the
+ *			current speed, possibly preempted. Only a share of
+ *			the elapsed time is delivered to the thread when the
+ *			hypervisor steals the rest.
+ *//*------------------------------------------------------------------------ */
+static void sim_work(void *priv, unsigned int iterations)
+{
+	struct sim *s = priv;
+	uint64_t d;
+
+	d = (uint64_t) (iterations * s->iter_ns /
+		(s->t >= SIM_START_NS + SIM_STEP_NS ? s->step_speed : 1.0));
+	s->t += (uint64_t) (d / s->share);
+	s->cpu_ns += d;
+	if (sim_rand(s) < s->preempt_rate * d / NSEC_PER_SEC)
+		s->t += (uint64_t) (sim_rand(s) * s->preempt_ns);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sim_wakeup
+ * @BRIEF		return the simulated wakeup latency.
+ * @RETURNS		wakeup latency, in ns
+ * @param[in,out]	s: simulated machine
+ * @DESCRIPTION		return the simulated wakeup latency (timer slack plus
+ *			random jitter).
+ *//*------------------------------------------------------------------------ */
+static uint64_t sim_wakeup(struct sim *s)
+{
+	return s->slack_ns + (uint64_t) (sim_rand(s) * s->jitter_ns);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sim_sleep
+ * @BRIEF		sleep on the simulated machine.
+ * @param[in,out]	priv: simulated machine
+ * @param[in]		ns: sleep time
+ * @DESCRIPTION		sleep on the simulated machine. A request longer than
+ *			the whole scenario (e.g. a wrapped idle time) fails
+ *			it, and is not slept.
+ *//*------------------------------------------------------------------------ */
+static void sim_sleep(void *priv, uint64_t ns)
+{
+	struct sim *s = priv;
+
+	if (ns > SIM_DURATION_NS) {
+		s->runaway = 1;
+		ns = 0;
+	}
+	s->t += ns + sim_wakeup(s);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sim_sleep_until
+ * @BRIEF		sleep until a given simulated time.
+ * @param[in,out]	priv: simulated machine
+ * @param[in]		deadline_ns: wakeup time
+ * @DESCRIPTION		sleep until a given simulated time.
+ *//*------------------------------------------------------------------------ */
+static void sim_sleep_until(void *priv, uint64_t deadline_ns)
+{
+	struct sim *s = priv;
+
+	if (deadline_ns > s->t)
+		s->t = deadline_ns + sim_wakeup(s);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sim_scenario
+ * @BRIEF		run one simulated scenario.
+ * @RETURNS		0 on success
+ *			-ENOMEM in case of allocation failure
+ * @param[in]		id: scenario number (also its random seed)
+ * @param[in]		period: PWM frame period in us, 0: legacy controller,
+ *				-1: picked randomly
+ * @param[out]		r: scenario parameters and results
+ * @DESCRIPTION		draw a random machine and target load, run a load
+ *			thread on it for SIM_DURATION_NS with a frequency step
+ *			at SIM_STEP_NS, and check the achieved load (CPU time
+ *			per window) before and after the step.
+ *			One scenario in SIM_COMPENSATED instead targets a load
+ *			near 100% while part of the time is stolen, with steal
+ *			compensation on: the thread must then get the target
+ *			load, or all the CPU time delivered if less.
+ *//*------------------------------------------------------------------------ */
+static int sim_scenario(unsigned int id, long int period,
+	struct sim_result *r)
+{
+	struct sim s;
+	struct clg_ops ops = {sim_now, sim_work, sim_sleep, sim_sleep_until,
+		&s};
+	struct steal_cpu steal;
+	struct clg_thread *t;
+	double load[SIM_WINDOWS], err, expect;
+	char conv[24];
+	uint64_t win_start, win_cpu;
+	unsigned int w, n_pre, n_post;
+
+	memset(&s, 0, sizeof(s));
+	s.rng = id;
+	s.t = SIM_START_NS;
+	r->load = 1 + (int) (sim_rand(&s) * 100);
+	r->period = (period >= 0) ? period :
+		sim_periods[(int) (sim_rand(&s) * SIM_PERIODS)];
+	s.iter_ns = 5.0 + sim_rand(&s) * 45.0;
+	s.step_speed = sim_steps[(int) (sim_rand(&s) * SIM_STEPS)];
+	s.preempt_rate = sim_rand(&s) * 10.0;
+	s.preempt_ns = 1000000;
+	s.slack_ns = 50000;
+	s.jitter_ns = (uint64_t) (sim_rand(&s) * 100000);
+	s.clock_ns = 25;
+	s.share = 1.0;
+	if (id % SIM_COMPENSATED == SIM_COMPENSATED - 1) {
+		r->load = 90 + (int) (sim_rand(&s) * 11);
+		s.share = 0.5 + sim_rand(&s) * 0.5;
+	}
+	r->share = s.share;
+	expect = fmin(r->load, 100.0 * s.share);
+
+	t = clg_thread_new(&ops, r->load, r->period);
+	if (t == NULL)
+		return -ENOMEM;
+	if (s.share < 1.0) {
+		memset(&steal, 0, sizeof(steal));
+		steal.scale = (uint32_t) (s.share * STEAL_SCALE);
+		clg_thread_compensate(t, NULL, &steal);
+	}
+
+	/* Run frames, measuring achieved load per window */
+	w = 0;
+	win_start = s.t;
+	win_cpu = s.cpu_ns;
+	while (w < SIM_WINDOWS) {
+		clg_thread_frame(t);
+		if (s.t < SIM_START_NS + (w + 1) * SIM_WINDOW_NS)
+			continue;
+		load[w] = 100.0 * (s.cpu_ns - win_cpu) / (s.t - win_start);
+		win_start = s.t;
+		win_cpu = s.cpu_ns;
+		w++;
+		/* A long frame may cover several windows */
+		while ((w < SIM_WINDOWS) &&
+			(s.t >= SIM_START_NS + (w + 1) * SIM_WINDOW_NS)) {
+			load[w] = load[w - 1];
+			w++;
+		}
+	}
+	clg_thread_free(t);
+
+	/* Steady state error, skipping start-up, before and after step */
+	r->err_pre = r->err_post = 0.0;
+	n_pre = n_post = 0;
+	for (w = 3; w < SIM_STEP_NS / SIM_WINDOW_NS; w++, n_pre++)
+		r->err_pre += load[w] - expect;
+	for (w = SIM_WINDOWS - 10; w < SIM_WINDOWS; w++, n_post++)
+		r->err_post += load[w] - expect;
+	r->err_pre /= n_pre;
+	r->err_post /= n_post;
+
+	/*
+	 * Convergence: end of the first window after step within tolerance
+	 * (window resolution: a load converged within the first window
+	 * reports the window length, not 0)
+	 */
+	r->converge_ms = -1;
+	for (w = SIM_STEP_NS / SIM_WINDOW_NS; w < SIM_WINDOWS; w++) {
+		err = load[w] - expect;
+		if (fabs(err) <= SIM_TOLERANCE) {
+			r->converge_ms = (w + 1 - SIM_STEP_NS / SIM_WINDOW_NS) *
+				(SIM_WINDOW_NS / 1000000);
+			break;
+		}
+	}
+
+	r->pass = !s.runaway && (fabs(r->err_pre) <= SIM_TOLERANCE) &&
+		(fabs(r->err_post) <= SIM_TOLERANCE) &&
+		(r->converge_ms >= 0) &&
+		(r->converge_ms <= SIM_CONVERGENCE_MS);
+
+	output_begin("simulation");
+	output_field_int("scenario", id);
+	output_field_int("load", r->load);
+	output_field_int("period", r->period);
+	output_field_double("iter_ns", s.iter_ns);
+	output_field_double("step_speed", s.step_speed);
+	output_field_double("share", s.share);
+	output_field_double("preempt_rate", s.preempt_rate);
+	output_field_int("jitter_ns", s.jitter_ns);
+	output_field_double("err_pre", r->err_pre);
+	output_field_double("err_post", r->err_post);
+	if (r->converge_ms < 0)
+		output_field_null("converge_ms");
+	else
+		output_field_int("converge_ms", r->converge_ms);
+	output_field_int("pass", r->pass);
+	output_end();
+
+	if (r->converge_ms < 0)
+		snprintf(conv, sizeof(conv), "never");
+	else
+		snprintf(conv, sizeof(conv), "%ldms", r->converge_ms);
+	if (!r->pass)
+		iprintf("\tFAIL scenario %u: load %d%%, period %ldus, %.0f%% delivered, %.1fns/iteration, speed x%.2f at %llums, %.1f preemptions/s, jitter %lluus: error %+.2f%% / %+.2f%%, convergence %s%s\n",
+			id, r->load, r->period, 100.0 * s.share, s.iter_ns,
+			s.step_speed, SIM_STEP_NS / 1000000, s.preempt_rate,
+			(unsigned long long) s.jitter_ns / 1000,
+			r->err_pre, r->err_post, conv,
+			s.runaway ? ", runaway sleep" : "");
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sim_run
+ * @BRIEF		check controller accuracy on simulated scenarios.
+ * @RETURNS		number of failed scenarios (>= 0)
+ *			-ENOMEM in case of allocation failure
+ * @param[in]		count: number of scenarios
+ * @param[in]		period: PWM frame period in us, 0: legacy controller,
+ *				-1: picked randomly per scenario
+ * @DESCRIPTION		run the load controllers on count simulated scenarios
+ *			(random CPU speed, frequency step, preemption, timer
+ *			slack and jitter; reproducible) and print achieved
+ *			load error and convergence time per controller.
+ *//*------------------------------------------------------------------------ */
+int sim_run(unsigned int count, long int period)
+{
+	struct sim_result r;
+	struct {
+		long int period;
+		unsigned int n, fail;
+		double err_sum, err_max;
+		long int conv_max;
+	} sum[SIM_PERIODS], *p;
+	unsigned int i, j, fails = 0;
+	char name[24];
+	double err;
+	int ret;
+
+	memset(sum, 0, sizeof(sum));
+	for (j = 0; j < SIM_PERIODS; j++)
+		sum[j].period = sim_periods[j];
+
+	iprintf("Simulating %u scenarios (%llus each, tolerance %.1f%%, convergence %dms)...\n",
+		count, SIM_DURATION_NS / NSEC_PER_SEC, SIM_TOLERANCE,
+		SIM_CONVERGENCE_MS);
+	for (i = 0; i < count; i++) {
+		ret = sim_scenario(i, period, &r);
+		if (ret != 0)
+			return ret;
+		for (j = 0; j < SIM_PERIODS - 1; j++)
+			if (sum[j].period == r.period)
+				break;
+		p = &sum[j];
+		p->period = r.period;
+		p->n++;
+		p->fail += !r.pass;
+		fails += !r.pass;
+		err = fmax(fabs(r.err_pre), fabs(r.err_post));
+		p->err_sum += err;
+		if (err > p->err_max)
+			p->err_max = err;
+		if ((r.converge_ms < 0) || (p->conv_max < 0))
+			p->conv_max = -1;
+		else if (r.converge_ms > p->conv_max)
+			p->conv_max = r.converge_ms;
+	}
+
+	iprintf("\n\t%-10s %9s %9s %12s %12s %14s\n", "period", "scenarios",
+		"failed", "mean |err|", "max |err|", "max converge");
+	for (j = 0; j < SIM_PERIODS; j++) {
+		p = &sum[j];
+		if (p->n == 0)
+			continue;
+		if (p->period == 0)
+			snprintf(name, sizeof(name), "legacy");
+		else
+			snprintf(name, sizeof(name), "%ldus", p->period);
+		iprintf("\t%-10s", name);
+		if (p->conv_max < 0)
+			iprintf(" %9u %9u %11.2f%% %11.2f%% %14s\n", p->n,
+				p->fail, p->err_sum / p->n, p->err_max, "never");
+		else
+			iprintf(" %9u %9u %11.2f%% %11.2f%% %12ldms\n", p->n,
+				p->fail, p->err_sum / p->n, p->err_max,
+				p->conv_max);
+	}
+
+	return fails;
+}
@@ -0,0 +1,595 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			stats.c
+ * @Description			Lock-free per-thread statistics and reporter
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "cpuloadgen.h"
+#include "clg.h"
+#include "stats.h"
+#include "output.h"
+#include "perfcnt.h"
+#include "verify.h"
+#include "thermal.h"
+
+
+/* Everything the reporter samples for one CPU */
+struct stats_sample {
+	struct stats_counters c;
+	struct perfcnt_values perf;
+	struct verify_values ver;
+};
+
+
+static struct stats_slot *slots = NULL;
+static unsigned int slot_count = 0;
+
+static pthread_t reporter;
+static int reporter_running = 0;
+static int reporter_stop;
+static pthread_mutex_t reporter_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reporter_cond;
+static uint64_t reporter_interval_ns;
+static int reporter_print;
+static int reporter_summary;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_init
+ * @BRIEF		allocate one statistics slot per CPU.
+ * @RETURNS		0 on success
+ *			-ENOMEM in case of allocation failure
+ * @param[in]		count: number of slots (CPU cores)
+ * @DESCRIPTION		allocate one statistics slot per CPU.
+ *			All slots start inactive (load == -1).
+ *//*------------------------------------------------------------------------ */
+int stats_init(unsigned int count)
+{
+	unsigned int i;
+
+	if (posix_memalign((void **) &slots, STATS_CACHELINE_SIZE,
+		count * sizeof(struct stats_slot)) != 0) {
+		slots = NULL;
+		return -ENOMEM;
+	}
+	memset(slots, 0, count * sizeof(struct stats_slot));
+	for (i = 0; i < count; i++) {
+		slots[i].load = -1;
+		slots[i].cpu = -1;
+	}
+	slot_count = count;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_slot_get
+ * @BRIEF		return statistics slot of a given CPU.
+ * @RETURNS		pointer to slot, NULL if out of range
+ * @param[in]		cpu: CPU core ID
+ * @DESCRIPTION		return statistics slot of a given CPU.
+ *//*------------------------------------------------------------------------ */
+struct stats_slot *stats_slot_get(unsigned int cpu)
+{
+	if ((slots == NULL) || (cpu >= slot_count))
+		return NULL;
+	return &slots[cpu];
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_snapshot
+ * @BRIEF		take a consistent copy of a slot's counters.
+ * @param[in]		cpu: CPU core ID
+ * @param[out]		c: counters copy
+ * @DESCRIPTION		take a consistent copy of a slot's counters.
+ *			Retry while the owning thread is mid-update.
+ *//*------------------------------------------------------------------------ */
+void stats_snapshot(unsigned int cpu, struct stats_counters *c)
+{
+	struct stats_slot *slot = &slots[cpu];
+	uint32_t seq1, seq2;
+
+	do {
+		seq1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		c->frames = __atomic_load_n(&slot->c.frames,
+			__ATOMIC_RELAXED);
+		c->busy_ns = __atomic_load_n(&slot->c.busy_ns,
+			__ATOMIC_RELAXED);
+		c->idle_ns = __atomic_load_n(&slot->c.idle_ns,
+			__ATOMIC_RELAXED);
+		c->overshoot_ns = __atomic_load_n(&slot->c.overshoot_ns,
+			__ATOMIC_RELAXED);
+		c->iterations = __atomic_load_n(&slot->c.iterations,
+			__ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+	} while ((seq1 & 1) || (seq1 != seq2));
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_phase_get
+ * @BRIEF		return the PWM phase a load thread is in.
+ * @RETURNS		STATS_PHASE_BUSY or STATS_PHASE_IDLE
+ * @param[in]		cpu: CPU core ID
+ * @DESCRIPTION		return the PWM phase a load thread is in.
+ *//*------------------------------------------------------------------------ */
+uint32_t stats_phase_get(unsigned int cpu)
+{
+	return __atomic_load_n(&slots[cpu].phase, __ATOMIC_RELAXED);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_cpu_get
+ * @BRIEF		return the CPU a load thread last ran on.
+ * @RETURNS		CPU core ID, -1 if not known yet
+ * @param[in]		cpu: CPU core ID the thread loads (slot)
+ * @DESCRIPTION		return the CPU a load thread last ran on, as
+ *			published at the start of its latest frame.
+ *//*------------------------------------------------------------------------ */
+int stats_cpu_get(unsigned int cpu)
+{
+	return __atomic_load_n(&slots[cpu].cpu, __ATOMIC_RELAXED);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_sample_take
+ * @BRIEF		sample all counters of a CPU.
+ * @param[in]		cpu: CPU core ID
+ * @param[out]		s: sample
+ * @DESCRIPTION		sample all counters of a CPU.
+ *//*------------------------------------------------------------------------ */
+static void stats_sample_take(unsigned int cpu, struct stats_sample *s)
+{
+	stats_snapshot(cpu, &s->c);
+	if (perfcnt_enabled())
+		perfcnt_read(cpu, &s->perf);
+	if (verify_enabled())
+		verify_read(cpu, &s->ver);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_sample_delta
+ * @BRIEF		compute difference between two samples.
+ * @param[in]		cur: latest sample
+ * @param[in]		prev: previous sample
+ * @param[out]		d: cur - prev
+ * @DESCRIPTION		compute difference between two samples.
+ *//*------------------------------------------------------------------------ */
+static void stats_sample_delta(const struct stats_sample *cur,
+	const struct stats_sample *prev, struct stats_sample *d)
+{
+	unsigned int e;
+
+	d->c.frames = cur->c.frames - prev->c.frames;
+	d->c.busy_ns = cur->c.busy_ns - prev->c.busy_ns;
+	d->c.idle_ns = cur->c.idle_ns - prev->c.idle_ns;
+	d->c.overshoot_ns = cur->c.overshoot_ns - prev->c.overshoot_ns;
+	d->c.iterations = cur->c.iterations - prev->c.iterations;
+	d->perf.valid = cur->perf.valid;
+	for (e = 0; e < PERFCNT_MAX; e++)
+		d->perf.v[e] = cur->perf.v[e] - prev->perf.v[e];
+	d->ver.valid = cur->ver.valid;
+	if ((cur->ver.valid & VERIFY_CPU) && !(prev->ver.valid & VERIFY_CPU))
+		d->ver.valid &= ~VERIFY_CPU;	/* no baseline */
+	d->ver.task_runtime_ns =
+		cur->ver.task_runtime_ns - prev->ver.task_runtime_ns;
+	d->ver.task_wait_ns = cur->ver.task_wait_ns - prev->ver.task_wait_ns;
+	d->ver.cpu_busy_ticks =
+		cur->ver.cpu_busy_ticks - prev->ver.cpu_busy_ticks;
+	d->ver.cpu_total_ticks =
+		cur->ver.cpu_total_ticks - prev->ver.cpu_total_ticks;
+	d->ver.cpu_steal_ticks =
+		cur->ver.cpu_steal_ticks - prev->ver.cpu_steal_ticks;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_load_str
+ * @BRIEF		format a requested load.
+ * @RETURNS		buf
+ * @param[in]		load: requested load
+ * @param[out]		buf: string buffer
+ * @param[in]		size: string buffer size
+ * @DESCRIPTION		format a requested load ("ops" for throughput
+ *			targets), 4 characters wide.
+ *//*------------------------------------------------------------------------ */
+static const char *stats_load_str(int load, char *buf, size_t size)
+{
+	if (load == CLG_LOAD_RATE)
+		snprintf(buf, size, " ops");
+	else
+		snprintf(buf, size, "%3d%%", load);
+	return buf;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_print_verify
+ * @BRIEF		print and emit requested vs achieved load.
+ * @param[in]		load: requested load
+ * @param[in]		d: sample delta over the interval
+ * @param[in]		period_ns: interval duration (in ns)
+ * @param[in]		print: also print human-readable line if != 0
+ * @DESCRIPTION		print and emit requested vs achieved load, as seen
+ *			by the controller (busy / frame time), by the
+ *			scheduler (thread runtime from schedstat) and by
+ *			the CPU accounting (/proc/stat) of the CPUs the
+ *			thread ran on.
+ *//*------------------------------------------------------------------------ */
+static void stats_print_verify(int load,
+	const struct stats_sample *d, uint64_t period_ns, int print)
+{
+	const struct verify_values *v = &d->ver;
+	uint64_t frame_ns = d->c.busy_ns + d->c.idle_ns;
+	char lstr[8];
+
+	/* Same columns in every record, empty when not available */
+	if (v->valid & VERIFY_TASK) {
+		output_field_u64("task_runtime_ns", v->task_runtime_ns);
+		output_field_u64("task_wait_ns", v->task_wait_ns);
+	} else {
+		output_field_null("task_runtime_ns");
+		output_field_null("task_wait_ns");
+	}
+	if (v->valid & VERIFY_CPU) {
+		output_field_u64("cpu_busy_ticks", v->cpu_busy_ticks);
+		output_field_u64("cpu_total_ticks", v->cpu_total_ticks);
+		output_field_u64("cpu_steal_ticks", v->cpu_steal_ticks);
+	} else {
+		output_field_null("cpu_busy_ticks");
+		output_field_null("cpu_total_ticks");
+		output_field_null("cpu_steal_ticks");
+	}
+	if (!print)
+		return;
+
+	iprintf("%12s verify: requested %s controller %5.1f%%", "",
+		stats_load_str(load, lstr, sizeof(lstr)),
+		frame_ns ? 100.0 * (double) d->c.busy_ns / frame_ns : 0.0);
+	if ((v->valid & VERIFY_TASK) && (period_ns != 0))
+		iprintf(" task %5.1f%% (runnable %5.1f%%)",
+			100.0 * (double) v->task_runtime_ns / period_ns,
+			100.0 * (double) v->task_wait_ns / period_ns);
+	else
+		iprintf(" task   n/a");
+	if ((v->valid & VERIFY_CPU) && (v->cpu_total_ticks != 0))
+		iprintf(" cpu %5.1f%% steal %5.1f%%", 100.0 *
+			(double) v->cpu_busy_ticks / v->cpu_total_ticks,
+			100.0 * (double) v->cpu_steal_ticks /
+			v->cpu_total_ticks);
+	else
+		iprintf(" cpu   n/a");
+	iprintf("\n");
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_print_perf
+ * @BRIEF		print and emit performance counters delta.
+ * @param[in]		p: performance counters delta
+ * @param[in]		print: also print human-readable line if != 0
+ * @DESCRIPTION		print and emit performance counters delta.
+ *			Derived metrics (IPC, effective frequency, miss
+ *			ratios) are only printed; raw counts are emitted,
+ *			empty for counters not available.
+ *//*------------------------------------------------------------------------ */
+static void stats_print_perf(const struct perfcnt_values *p, int print)
+{
+	unsigned int e;
+
+#define HAS(id)		(p->valid & (1U << (id)))
+#define V(id)		((double) p->v[id])
+	/* Same columns in every record, empty when not counted */
+	for (e = 0; e < PERFCNT_MAX; e++)
+		if (HAS(e))
+			output_field_u64(perfcnt_name(e), p->v[e]);
+		else
+			output_field_null(perfcnt_name(e));
+	if (!print)
+		return;
+
+	iprintf("%12s perf:", "");
+	if (HAS(PERFCNT_CYCLES) && HAS(PERFCNT_INSTRUCTIONS) &&
+		(p->v[PERFCNT_CYCLES] != 0))
+		iprintf(" IPC %5.2f", V(PERFCNT_INSTRUCTIONS) /
+			V(PERFCNT_CYCLES));
+	if (HAS(PERFCNT_CYCLES) && HAS(PERFCNT_TASK_CLOCK) &&
+		(p->v[PERFCNT_TASK_CLOCK] != 0))
+		iprintf(" GHz %5.2f", V(PERFCNT_CYCLES) /
+			V(PERFCNT_TASK_CLOCK));
+	if (HAS(PERFCNT_CACHE_REFS) && HAS(PERFCNT_CACHE_MISSES) &&
+		(p->v[PERFCNT_CACHE_REFS] != 0))
+		iprintf(" cache-miss %5.2f%%", 100.0 *
+			V(PERFCNT_CACHE_MISSES) / V(PERFCNT_CACHE_REFS));
+	if (HAS(PERFCNT_BRANCH_MISSES) && HAS(PERFCNT_INSTRUCTIONS) &&
+		(p->v[PERFCNT_INSTRUCTIONS] != 0))
+		iprintf(" br-miss/kinst %6.3f", 1.0e3 *
+			V(PERFCNT_BRANCH_MISSES) / V(PERFCNT_INSTRUCTIONS));
+	if (HAS(PERFCNT_DTLB_MISSES) && HAS(PERFCNT_INSTRUCTIONS) &&
+		(p->v[PERFCNT_INSTRUCTIONS] != 0))
+		iprintf(" dtlb-miss/kinst %6.3f", 1.0e3 *
+			V(PERFCNT_DTLB_MISSES) / V(PERFCNT_INSTRUCTIONS));
+	if (HAS(PERFCNT_TASK_CLOCK))
+		iprintf(" cpu-ms %8.1f", V(PERFCNT_TASK_CLOCK) / 1.0e6);
+	if (HAS(PERFCNT_CTX_SWITCHES))
+		iprintf(" cs %6llu",
+			(unsigned long long) p->v[PERFCNT_CTX_SWITCHES]);
+	if (HAS(PERFCNT_MIGRATIONS))
+		iprintf(" migr %4llu",
+			(unsigned long long) p->v[PERFCNT_MIGRATIONS]);
+	if (HAS(PERFCNT_PAGE_FAULTS))
+		iprintf(" faults %6llu",
+			(unsigned long long) p->v[PERFCNT_PAGE_FAULTS]);
+	if (HAS(PERFCNT_MAJOR_FAULTS) && (p->v[PERFCNT_MAJOR_FAULTS] != 0))
+		iprintf(" major %6llu",
+			(unsigned long long) p->v[PERFCNT_MAJOR_FAULTS]);
+	iprintf("\n");
+#undef HAS
+#undef V
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_print
+ * @BRIEF		print and emit one statistics record for a CPU.
+ * @param[in]		type: structured output record type
+ * @param[in]		t: elapsed time since reporter start (in seconds)
+ * @param[in]		cpu: CPU core ID
+ * @param[in]		load: requested load
+ * @param[in]		d: sample delta over the interval
+ * @param[in]		period_ns: interval duration (in ns)
+ * @param[in]		print: also print human-readable lines if != 0
+ * @DESCRIPTION		print and emit one statistics record for a CPU.
+ *//*------------------------------------------------------------------------ */
+static void stats_print(const char *type, double t, unsigned int cpu,
+	int load, const struct stats_sample *d, uint64_t period_ns,
+	int print)
+{
+	double secs = (double) period_ns * 1.0e-9;
+	uint64_t frame_ns = d->c.busy_ns + d->c.idle_ns;
+	char lstr[8];
+
+	output_begin(type);
+	output_field_double("t", t);
+	output_field_int("cpu", cpu);
+	output_field_int("load", load);
+	output_field_u64("period_ns", period_ns);
+	output_field_u64("frames", d->c.frames);
+	output_field_u64("busy_ns", d->c.busy_ns);
+	output_field_u64("idle_ns", d->c.idle_ns);
+	output_field_u64("overshoot_ns", d->c.overshoot_ns);
+	output_field_u64("iterations", d->c.iterations);
+
+	if (print)
+		iprintf("[%8.2fs] CPU%u: load %s frames/s %7.1f busy %5.1f%% "
+			"idle %5.1f%% overshoot %6.0fus kiter/s %9.1f\n",
+			t, cpu, stats_load_str(load, lstr, sizeof(lstr)), (double) d->c.frames / secs,
+			frame_ns ? 100.0 * (double) d->c.busy_ns / frame_ns : 0.0,
+			frame_ns ? 100.0 * (double) d->c.idle_ns / frame_ns : 0.0,
+			d->c.frames ?
+				(double) d->c.overshoot_ns / d->c.frames / 1.0e3 : 0.0,
+			(double) d->c.iterations / secs / 1.0e3);
+	if (perfcnt_enabled())
+		stats_print_perf(&d->perf, print);
+	if (verify_enabled())
+		stats_print_verify(load, d, period_ns, print);
+	output_end();
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_reporter
+ * @BRIEF		reporter thread: aggregate and print slots periodically.
+ * @param[in]		arg: unused
+ * @DESCRIPTION		reporter thread: aggregate and print slots periodically.
+ *			Never touches load threads other than by reading
+ *			their slots and counters.
+ *//*------------------------------------------------------------------------ */
+static void *stats_reporter(void *arg UNUSED)
+{
+	struct stats_sample *first, *prev, cur, d;
+	struct timespec deadline;
+	uint64_t start, last, now, next;
+	unsigned int i;
+	int load, stop = 0;
+
+	first = calloc(slot_count, sizeof(struct stats_sample));
+	prev = calloc(slot_count, sizeof(struct stats_sample));
+	if ((first == NULL) || (prev == NULL)) {
+		fprintf(stderr, "cpuloadgen: could not allocate reporter buffers!!!\n");
+		free(first);
+		free(prev);
+		return NULL;
+	}
+
+	/* Baseline */
+	verify_update();
+	for (i = 0; i < slot_count; i++) {
+		if (__atomic_load_n(&slots[i].load, __ATOMIC_RELAXED) == -1)
+			continue;
+		stats_sample_take(i, &first[i]);
+		prev[i] = first[i];
+	}
+
+	start = last = now_ns();
+	next = start;
+	while (!stop) {
+		next += reporter_interval_ns;
+		deadline.tv_sec = next / NSEC_PER_SEC;
+		deadline.tv_nsec = next % NSEC_PER_SEC;
+		pthread_mutex_lock(&reporter_mutex);
+		while (!reporter_stop && (now_ns() < next))
+			pthread_cond_timedwait(&reporter_cond, &reporter_mutex,
+				&deadline);
+		stop = reporter_stop;
+		pthread_mutex_unlock(&reporter_mutex);
+
+		now = now_ns();
+		verify_update();
+		for (i = 0; i < slot_count; i++) {
+			/* Written by the load thread when retargeted */
+			load = __atomic_load_n(&slots[i].load, __ATOMIC_RELAXED);
+			if (load == -1)
+				continue;
+			stats_sample_take(i, &cur);
+			stats_sample_delta(&cur, &prev[i], &d);
+			if (!stop) {
+				stats_print("sample",
+					(double) (now - start) * 1.0e-9, i,
+					load, &d, now - last,
+					reporter_print);
+				thermal_throughput((double) (now - start) * 1.0e-9,
+					i, load, d.c.iterations,
+					d.c.busy_ns);
+			}
+			prev[i] = cur;
+		}
+		if (!stop)
+			thermal_sample((double) (now - start) * 1.0e-9,
+				now - last, reporter_print);
+		last = now;
+		fflush(output_info_stream());
+		output_flush();
+	}
+
+	/* Summary over the whole run */
+	if (reporter_summary)
+		iprintf("\nStatistics summary (%.2fs):\n",
+			(double) (now - start) * 1.0e-9);
+	for (i = 0; i < slot_count; i++) {
+		load = __atomic_load_n(&slots[i].load, __ATOMIC_RELAXED);
+		if (load == -1)
+			continue;
+		stats_sample_delta(&prev[i], &first[i], &d);
+		stats_print("summary", (double) (now - start) * 1.0e-9, i,
+			load, &d, now - start, reporter_summary);
+	}
+	fflush(output_info_stream());
+	output_flush();
+
+	free(first);
+	free(prev);
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_reporter_start
+ * @BRIEF		start periodic statistics reporting.
+ * @RETURNS		0 on success
+ *			-EINVAL in case of invalid interval
+ *			pthread error code otherwise
+ * @param[in]		interval: reporting interval (in seconds)
+ * @param[in]		print: also print human-readable samples if != 0
+ * @param[in]		summary: also print human-readable summary if != 0
+ * @DESCRIPTION		start periodic statistics reporting.
+ *			Samples and summary are always emitted to the
+ *			structured output, if enabled. Samples also feed
+ *			thermal telemetry.
+ *//*------------------------------------------------------------------------ */
+int stats_reporter_start(double interval, int print, int summary)
+{
+	pthread_condattr_t attr;
+	int ret;
+
+	if ((interval <= 0.0) || (slots == NULL))
+		return -EINVAL;
+
+	reporter_interval_ns = (uint64_t) (interval * 1.0e9);
+	reporter_print = print;
+	reporter_summary = print || summary;
+	reporter_stop = 0;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&reporter_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	ret = pthread_create(&reporter, NULL, stats_reporter, NULL);
+	if (ret != 0)
+		return ret;
+	reporter_running = 1;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_reporter_stop
+ * @BRIEF		stop reporter thread, printing final summary.
+ * @DESCRIPTION		stop reporter thread, printing final summary.
+ *//*------------------------------------------------------------------------ */
+void stats_reporter_stop(void)
+{
+	if (!reporter_running)
+		return;
+
+	pthread_mutex_lock(&reporter_mutex);
+	reporter_stop = 1;
+	pthread_cond_signal(&reporter_cond);
+	pthread_mutex_unlock(&reporter_mutex);
+	pthread_join(reporter, NULL);
+	pthread_cond_destroy(&reporter_cond);
+	reporter_running = 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_deinit
+ * @BRIEF		free statistics slots.
+ * @DESCRIPTION		free statistics slots.
+ *			Must not be called while load threads are running.
+ *//*------------------------------------------------------------------------ */
+void stats_deinit(void)
+{
+	stats_reporter_stop();
+	free(slots);
+	slots = NULL;
+	slot_count = 0;
+}
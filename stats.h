@@ -0,0 +1,145 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			stats.h
+ * @Description			Lock-free per-thread statistics and reporter
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdint.h>
+
+#define STATS_CACHELINE_SIZE	64
+
+/* PWM phase a load thread is in */
+#define STATS_PHASE_BUSY	0
+#define STATS_PHASE_IDLE	1
+#define STATS_PHASES		2
+
+/* Counters published by a load thread, all monotonically increasing */
+struct stats_counters {
+	uint64_t frames;
+	uint64_t busy_ns;
+	uint64_t idle_ns;
+	uint64_t overshoot_ns;
+	uint64_t iterations;
+};
+
+/*
+ * One slot per CPU, written by a single load thread and read by the
+ * reporter. A sequence counter (odd while an update is in progress) lets
+ * the reader retry on a torn read instead of taking a lock. Slots are
+ * cacheline-aligned so that threads never share a line.
+ * The current PWM phase and the CPU the thread last ran on (threads are not
+ * pinned) are published separately, outside of the sequence, for telemetry
+ * samplers that correlate with busy/idle slices.
+ */
+struct stats_slot {
+	uint32_t seq;
+	int load;
+	uint32_t phase;
+	int cpu;		/* -1: not known yet */
+	struct stats_counters c;
+} __attribute__((aligned(STATS_CACHELINE_SIZE)));
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_set_phase
+ * @BRIEF		publish the PWM phase a thread enters.
+ * @param[in,out]	slot: slot owned by the calling thread
+ * @param[in]		phase: STATS_PHASE_BUSY or STATS_PHASE_IDLE
+ * @DESCRIPTION		publish the PWM phase a thread enters (single store).
+ *//*------------------------------------------------------------------------ */
+static inline void stats_set_phase(struct stats_slot *slot, uint32_t phase)
+{
+	__atomic_store_n(&slot->phase, phase, __ATOMIC_RELAXED);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_set_cpu
+ * @BRIEF		publish the CPU a thread runs on.
+ * @param[in,out]	slot: slot owned by the calling thread
+ * @param[in]		cpu: CPU core ID (e.g. from sched_getcpu())
+ * @DESCRIPTION		publish the CPU a thread runs on (single store).
+ *//*------------------------------------------------------------------------ */
+static inline void stats_set_cpu(struct stats_slot *slot, int cpu)
+{
+	__atomic_store_n(&slot->cpu, cpu, __ATOMIC_RELAXED);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		stats_publish
+ * @BRIEF		publish a thread's counters into its slot.
+ * @param[in,out]	slot: slot owned by the calling thread
+ * @param[in]		c: up-to-date counters
+ * @DESCRIPTION		publish a thread's counters into its slot.
+ *			Only the owning thread may call this. Costs a handful
+ *			of plain stores, no lock and no atomic RMW.
+ *//*------------------------------------------------------------------------ */
+static inline void stats_publish(struct stats_slot *slot,
+	const struct stats_counters *c)
+{
+	uint32_t seq = slot->seq;
+
+	__atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&slot->c.frames, c->frames, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->c.busy_ns, c->busy_ns, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->c.idle_ns, c->idle_ns, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->c.overshoot_ns, c->overshoot_ns,
+		__ATOMIC_RELAXED);
+	__atomic_store_n(&slot->c.iterations, c->iterations,
+		__ATOMIC_RELAXED);
+	__atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+
+int stats_init(unsigned int count);
+struct stats_slot *stats_slot_get(unsigned int cpu);
+void stats_snapshot(unsigned int cpu, struct stats_counters *c);
+uint32_t stats_phase_get(unsigned int cpu);
+int stats_cpu_get(unsigned int cpu);
+int stats_reporter_start(double interval, int print, int summary);
+void stats_reporter_stop(void);
+void stats_deinit(void);
+
+
+#endif
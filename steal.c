@@ -0,0 +1,280 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			steal.c
+ * @Description			Steal time compensation for virtualized hosts
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "cpuloadgen.h"
+#include "output.h"
+#include "verify.h"
+#include "steal.h"
+
+
+static struct steal_cpu *steal_cpus = NULL;
+static unsigned int steal_count = 0;
+static uint64_t *busy, *total, *steal;
+
+static pthread_t sampler;
+static int sampler_running = 0;
+static int sampler_stop;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_init
+ * @BRIEF		enable steal time compensation.
+ * @RETURNS		0 on success, -ENOMEM otherwise
+ * @param[in]		count: number of CPU cores
+ * @DESCRIPTION		enable steal time compensation: load threads scale
+ *			busy slices by the wall / delivered time ratio of the
+ *			CPU they run on, so that the CPU time the guest
+ *			actually gets matches the requested load.
+ *//*------------------------------------------------------------------------ */
+int steal_init(unsigned int count)
+{
+	unsigned int cpu;
+
+	busy = calloc(count, sizeof(uint64_t));
+	total = calloc(count, sizeof(uint64_t));
+	steal = calloc(count, sizeof(uint64_t));
+	if ((busy == NULL) || (total == NULL) || (steal == NULL) ||
+		(posix_memalign((void **) &steal_cpus, STATS_CACHELINE_SIZE,
+		count * sizeof(struct steal_cpu)) != 0)) {
+		steal_cpus = NULL;
+		steal_deinit();
+		return -ENOMEM;
+	}
+	memset(steal_cpus, 0, count * sizeof(struct steal_cpu));
+	steal_count = count;
+	for (cpu = 0; cpu < count; cpu++)
+		steal_cpus[cpu].scale = STEAL_SCALE;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_enabled
+ * @BRIEF		tell whether steal time compensation is enabled.
+ * @RETURNS		1 if enabled, 0 otherwise
+ * @DESCRIPTION		tell whether steal time compensation is enabled.
+ *//*------------------------------------------------------------------------ */
+int steal_enabled(void)
+{
+	return steal_cpus != NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_get
+ * @BRIEF		return the steal state of a CPU a load thread runs on.
+ * @RETURNS		CPU steal state, NULL if disabled or invalid cpu
+ * @param[in]		cpu: CPU core ID (e.g. from sched_getcpu())
+ * @DESCRIPTION		return the steal state of a CPU a load thread runs
+ *			on, to be read with steal_scale(). The CPU is then
+ *			included in the report.
+ *//*------------------------------------------------------------------------ */
+struct steal_cpu *steal_get(int cpu)
+{
+	struct steal_cpu *s;
+
+	if ((steal_cpus == NULL) || (cpu < 0) ||
+		((unsigned int) cpu >= steal_count))
+		return NULL;
+	s = &steal_cpus[cpu];
+	if (!__atomic_load_n(&s->used, __ATOMIC_RELAXED))
+		__atomic_store_n(&s->used, 1, __ATOMIC_RELAXED);
+	return s;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_sample
+ * @BRIEF		update the delivered time share of all CPUs.
+ * @param[in]		first: 1 for the baseline sample
+ * @DESCRIPTION		update the delivered time share of all CPUs, from
+ *			their /proc/stat steal and total times over the last
+ *			period. Periods without ticks keep the previous share.
+ *//*------------------------------------------------------------------------ */
+static void steal_sample(int first)
+{
+	struct steal_cpu *s;
+	uint64_t ds, dt;
+	unsigned int cpu;
+	double ratio;
+
+	if (procstat_read(steal_count, busy, total, steal) != 0)
+		return;
+	for (cpu = 0; cpu < steal_count; cpu++) {
+		s = &steal_cpus[cpu];
+		ds = steal[cpu] - s->last_steal;
+		dt = total[cpu] - s->last_total;
+		s->last_steal = steal[cpu];
+		s->last_total = total[cpu];
+		if (first || (dt == 0))
+			continue;
+		s->steal_ticks += ds;
+		s->total_ticks += dt;
+		ratio = 1.0 - (double) ds / dt;
+		if (ratio < (double) STEAL_SCALE_MIN / STEAL_SCALE)
+			ratio = (double) STEAL_SCALE_MIN / STEAL_SCALE;
+		__atomic_store_n(&s->scale, (uint32_t) (ratio * STEAL_SCALE),
+			__ATOMIC_RELAXED);
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_sampler
+ * @BRIEF		steal time sampler thread.
+ * @param[in]		arg: unused
+ * @DESCRIPTION		steal time sampler thread: update all CPUs delivered
+ *			time share every STEAL_PERIOD_MS.
+ *//*------------------------------------------------------------------------ */
+static void *steal_sampler(void *arg UNUSED)
+{
+	struct timespec ts;
+	uint64_t next;
+
+	steal_sample(1);
+	next = now_ns();
+	while (!__atomic_load_n(&sampler_stop, __ATOMIC_ACQUIRE)) {
+		next += STEAL_PERIOD_MS * 1000000ULL;
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		steal_sample(0);
+	}
+
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_start
+ * @BRIEF		start the steal time sampler thread.
+ * @RETURNS		0 on success, pthread error code otherwise
+ * @DESCRIPTION		start the steal time sampler thread.
+ *//*------------------------------------------------------------------------ */
+int steal_start(void)
+{
+	int ret;
+
+	if (steal_cpus == NULL)
+		return 0;
+	sampler_stop = 0;
+	ret = pthread_create(&sampler, NULL, steal_sampler, NULL);
+	if (ret != 0)
+		return ret;
+	sampler_running = 1;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_stop
+ * @BRIEF		stop the steal time sampler thread.
+ * @DESCRIPTION		stop the steal time sampler thread.
+ *//*------------------------------------------------------------------------ */
+void steal_stop(void)
+{
+	if (!sampler_running)
+		return;
+	__atomic_store_n(&sampler_stop, 1, __ATOMIC_RELEASE);
+	pthread_join(sampler, NULL);
+	sampler_running = 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_report
+ * @BRIEF		print and emit steal time per CPU.
+ * @DESCRIPTION		print and emit steal time of the CPUs load threads
+ *			ran on, over the run. Must be called once the
+ *			sampler is stopped.
+ *//*------------------------------------------------------------------------ */
+void steal_report(void)
+{
+	struct steal_cpu *s;
+	unsigned int cpu;
+	double pct;
+
+	if (steal_cpus == NULL)
+		return;
+
+	iprintf("\nSteal time (busy slices scaled by wall / delivered time):\n");
+	for (cpu = 0; cpu < steal_count; cpu++) {
+		s = &steal_cpus[cpu];
+		if (!s->used)
+			continue;
+		pct = s->total_ticks ?
+			100.0 * (double) s->steal_ticks / s->total_ticks : 0.0;
+		iprintf("\tCPU%u: steal %5.1f%%\n", cpu, pct);
+
+		output_begin("steal");
+		output_field_int("cpu", cpu);
+		output_field_u64("steal_ticks", s->steal_ticks);
+		output_field_u64("total_ticks", s->total_ticks);
+		output_field_double("steal_pct", pct);
+		output_end();
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_deinit
+ * @BRIEF		free buffers.
+ * @DESCRIPTION		free buffers.
+ *			Must not be called while load threads are running.
+ *//*------------------------------------------------------------------------ */
+void steal_deinit(void)
+{
+	free(steal_cpus);
+	free(busy);
+	free(total);
+	free(steal);
+	steal_cpus = NULL;
+	busy = total = steal = NULL;
+	steal_count = 0;
+}
@@ -0,0 +1,93 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			steal.h
+ * @Description			Steal time compensation for virtualized hosts
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __STEAL_H__
+#define __STEAL_H__
+
+#include <stdint.h>
+#include "stats.h"
+
+/* Delivered / wall CPU time ratio, fixed point */
+#define STEAL_SCALE		1024
+#define STEAL_SCALE_MIN		(STEAL_SCALE / 16)
+#define STEAL_PERIOD_MS		100	/* /proc/stat sampling period */
+
+/*
+ * Per-CPU share of time not stolen by the hypervisor, written by the
+ * sampler thread and read by load threads once per frame.
+ */
+struct steal_cpu {
+	uint32_t scale;		/* STEAL_SCALE: no steal */
+	int used;		/* a load thread ran on this CPU */
+	uint64_t last_steal;
+	uint64_t last_total;
+	uint64_t steal_ticks;	/* while sampling */
+	uint64_t total_ticks;
+} __attribute__((aligned(STATS_CACHELINE_SIZE)));
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		steal_scale
+ * @BRIEF		return the share of time delivered to a CPU.
+ * @RETURNS		delivered / wall time (STEAL_SCALE: no steal)
+ * @param[in]		s: CPU steal state (NULL: disabled)
+ * @DESCRIPTION		return the share of time delivered to a CPU, over the
+ *			last sampling period.
+ *//*------------------------------------------------------------------------ */
+static inline uint32_t steal_scale(const struct steal_cpu *s)
+{
+	if (s == NULL)
+		return STEAL_SCALE;
+	return __atomic_load_n(&s->scale, __ATOMIC_RELAXED);
+}
+
+
+int steal_init(unsigned int count);
+int steal_enabled(void);
+struct steal_cpu *steal_get(int cpu);
+int steal_start(void);
+void steal_stop(void);
+void steal_report(void);
+void steal_deinit(void);
+
+
+#endif
@@ -0,0 +1,411 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			step.c
+ * @Description			DVFS step response probe
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include "cpuloadgen.h"
+#include "clg.h"
+#include "output.h"
+#include "kernel.h"
+#include "sysfs.h"
+#include "step.h"
+
+
+/* Step response of a CPU, summed over steps */
+struct step_curve {
+	unsigned int nbusy, nidle;	/* samples per phase */
+	double *busy;			/* iteration rate per sample */
+	double *idle;
+	unsigned int runs;
+};
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		step_sleep_until
+ * @BRIEF		sleep until an absolute time.
+ * @param[in]		t: CLOCK_MONOTONIC time, in ns
+ * @DESCRIPTION		sleep until an absolute time, resuming after signals.
+ *//*------------------------------------------------------------------------ */
+static void step_sleep_until(uint64_t t)
+{
+	struct timespec ts;
+
+	ts.tv_sec = t / NSEC_PER_SEC;
+	ts.tv_nsec = t % NSEC_PER_SEC;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+		;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		step_busy
+ * @BRIEF		run a busy phase and sample the iteration rate.
+ * @RETURNS		phase end time, in ns
+ * @param[in]		k: kernel variant
+ * @param[in]		state: kernel state
+ * @param[in]		probe: iterations per kernel call
+ * @param[in]		sample_ns: sampling period
+ * @param[in,out]	c: curve to add samples to
+ * @DESCRIPTION		run the kernel back to back for a busy phase, and add
+ *			the iteration rate over each sampling period to the
+ *			curve.
+ *//*------------------------------------------------------------------------ */
+static uint64_t step_busy(const struct kernel *k, void *state,
+	unsigned int probe, uint64_t sample_ns, struct step_curve *c)
+{
+	uint64_t start, window, end, now, iters;
+	unsigned int i;
+
+	start = window = now_ns();
+	now = start;
+	for (i = 0; i < c->nbusy; i++) {
+		end = start + (i + 1) * sample_ns;
+		iters = 0;
+		do {
+			k->run(state, probe);
+			iters += probe;
+			now = now_ns();
+		} while (now < end);
+		c->busy[i] += (double) iters * NSEC_PER_SEC / (now - window);
+		window = now;
+	}
+
+	return now;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		step_idle
+ * @BRIEF		run an idle phase and sample the iteration rate.
+ * @param[in]		k: kernel variant
+ * @param[in]		state: kernel state
+ * @param[in]		probe: iterations per probe
+ * @param[in]		start: phase start time, in ns
+ * @param[in]		sample_ns: sampling period
+ * @param[in,out]	c: curve to add samples to (idle NULL: do not sample)
+ * @DESCRIPTION		sleep for an idle phase, waking up once per sampling
+ *			period to time a short kernel probe (STEP_PROBE_NS at
+ *			full speed, after a quarter-length warm-up run),
+ *			whose iteration rate is added to the curve. Probes
+ *			keep the CPU busy about 1% of the time at the default
+ *			sampling period.
+ *//*------------------------------------------------------------------------ */
+static void step_idle(const struct kernel *k, void *state, unsigned int probe,
+	uint64_t start, uint64_t sample_ns, struct step_curve *c)
+{
+	uint64_t t0, t1;
+	unsigned int i;
+
+	for (i = 0; i < c->nidle; i++) {
+		step_sleep_until(start + (i + 1) * sample_ns);
+		/* Warm caches and predictors up after wakeup */
+		k->run(state, probe / 4 + 1);
+		t0 = now_ns();
+		k->run(state, probe);
+		t1 = now_ns();
+		if (c->idle != NULL)
+			c->idle[i] += (double) probe * NSEC_PER_SEC /
+				(t1 > t0 ? t1 - t0 : 1);
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		step_settle
+ * @BRIEF		return when a curve crosses a threshold.
+ * @RETURNS		index of the first sample past threshold, -1 if none
+ * @param[in]		v: mean iteration rate per sample
+ * @param[in]		n: number of samples
+ * @param[in]		threshold: iteration rate
+ * @param[in]		up: 1 for a rising curve, 0 for a falling one
+ * @DESCRIPTION		return the first sample of a curve at or past a
+ *			threshold.
+ *//*------------------------------------------------------------------------ */
+static int step_settle(const double *v, unsigned int n, double threshold,
+	int up)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		if (up ? (v[i] >= threshold) : (v[i] <= threshold))
+			return i;
+	return -1;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		step_tail
+ * @BRIEF		return the steady-state value of a curve.
+ * @RETURNS		mean of the last 10% of samples
+ * @param[in]		v: mean iteration rate per sample
+ * @param[in]		n: number of samples (> 0)
+ * @DESCRIPTION		return the steady-state value of a curve, the mean of
+ *			its last 10% of samples (at least one).
+ *//*------------------------------------------------------------------------ */
+static double step_tail(const double *v, unsigned int n)
+{
+	unsigned int i, m = (n / 10) ? n / 10 : 1;
+	double sum = 0.0;
+
+	for (i = n - m; i < n; i++)
+		sum += v[i];
+	return sum / m;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		step_report
+ * @BRIEF		print and emit the step response of a CPU.
+ * @param[in]		cpu: CPU core ID
+ * @param[in]		governor: cpufreq governor of the CPU
+ * @param[in]		sample_us: sampling period
+ * @param[in,out]	c: step response, summed over steps (averaged here)
+ * @DESCRIPTION		print and emit the step response of a CPU: steady
+ *			busy (peak) and idle (floor) iteration rates, and the
+ *			time after a step the rate takes to cover STEP_SETTLE
+ *			of the swing between them, up and down. The mean
+ *			curves are emitted as step records (one per sample),
+ *			the summary as a step_summary record.
+ *//*------------------------------------------------------------------------ */
+static void step_report(unsigned int cpu, const char *governor,
+	long int sample_us, struct step_curve *c)
+{
+	double peak, floor, swing;
+	int up = -1, down = -1, flat;
+	unsigned int i;
+
+	for (i = 0; i < c->nbusy; i++)
+		c->busy[i] /= c->runs;
+	for (i = 0; i < c->nidle; i++)
+		c->idle[i] /= c->runs;
+	peak = step_tail(c->busy, c->nbusy);
+	floor = step_tail(c->idle, c->nidle);
+	swing = peak - floor;
+	flat = fabs(swing) < STEP_FLAT * peak;
+	if (!flat) {
+		up = step_settle(c->busy, c->nbusy,
+			floor + STEP_SETTLE * swing, 1);
+		down = step_settle(c->idle, c->nidle,
+			peak - STEP_SETTLE * swing, 0);
+	}
+
+	iprintf("\tCPU%u (%s): busy %.2f M/s idle %.2f M/s ", cpu, governor,
+		peak / 1e6, floor / 1e6);
+	if (flat) {
+		iprintf("no frequency response\n");
+	} else {
+		if (up < 0)
+			iprintf("ramp-up > %.1fms ",
+				(double) c->nbusy * sample_us / 1000.0);
+		else
+			iprintf("ramp-up %.1fms ",
+				(double) (up + 1) * sample_us / 1000.0);
+		if (down < 0)
+			iprintf("ramp-down > %.1fms\n",
+				(double) c->nidle * sample_us / 1000.0);
+		else
+			iprintf("ramp-down %.1fms\n",
+				(double) (down + 1) * sample_us / 1000.0);
+	}
+
+	for (i = 0; i < c->nbusy + c->nidle; i++) {
+		output_begin("step");
+		output_field_int("cpu", cpu);
+		output_field_str("governor", governor);
+		output_field_str("phase", i < c->nbusy ? "busy" : "idle");
+		output_field_int("t_us", (long long) ((i < c->nbusy ? i :
+			i - c->nbusy) + 1) * sample_us);
+		output_field_double("rate", i < c->nbusy ? c->busy[i] :
+			c->idle[i - c->nbusy]);
+		output_end();
+	}
+	output_begin("step_summary");
+	output_field_int("cpu", cpu);
+	output_field_str("governor", governor);
+	output_field_int("steps", c->runs);
+	output_field_double("busy_rate", peak);
+	output_field_double("idle_rate", floor);
+	output_field_int("flat", flat);
+	output_field_int("ramp_up_us", (flat || up < 0) ? -1 :
+		(long long) (up + 1) * sample_us);
+	output_field_int("ramp_down_us", (flat || down < 0) ? -1 :
+		(long long) (down + 1) * sample_us);
+	output_end();
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		step_cpu
+ * @BRIEF		measure the step response of a CPU.
+ * @RETURNS		0 on success, negative error code otherwise
+ * @param[in]		cpu: CPU core ID
+ * @param[in]		k: kernel variant
+ * @param[in]		params: kernel parameters
+ * @param[in]		probe: iterations per probe
+ * @param[in]		cfg: step configuration
+ * @param[in,out]	c: curve buffers, cleared here
+ * @DESCRIPTION		measure the step response of a CPU: run the calling
+ *			thread on it, idle for a phase so that it settles,
+ *			then alternate busy and idle phases, sampling the
+ *			kernel iteration rate.
+ *//*------------------------------------------------------------------------ */
+static int step_cpu(unsigned int cpu, const struct kernel *k,
+	const char *params, unsigned int probe, const struct step_config *cfg,
+	struct step_curve *c)
+{
+	char path[SYSFS_PATH_MAX], governor[32];
+	uint64_t sample_ns = (uint64_t) cfg->sample_us * NSEC_PER_USEC;
+	double *idle;
+	void *state = NULL;
+	cpu_set_t set;
+	int s, ret = 0;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+		return -errno;
+	/* Kernel state is allocated on the CPU using it (first touch) */
+	if (k->init != NULL) {
+		state = k->init(params, &ret);
+		if (state == NULL)
+			return ret;
+	}
+	sysfs_path(path, sizeof(path),
+		SYSFS_CPU_PATH "/cpu%u/cpufreq/scaling_governor", cpu);
+	if (sysfs_read_str(path, governor, sizeof(governor)) != 0)
+		strcpy(governor, "none");
+
+	memset(c->busy, 0, c->nbusy * sizeof(double));
+	memset(c->idle, 0, c->nidle * sizeof(double));
+	c->runs = cfg->steps;
+
+	/* Settle at idle first, without sampling */
+	idle = c->idle;
+	c->idle = NULL;
+	step_idle(k, state, probe, now_ns(), sample_ns, c);
+	c->idle = idle;
+	for (s = 0; s < cfg->steps; s++)
+		step_idle(k, state, probe, step_busy(k, state, probe,
+			sample_ns, c), sample_ns, c);
+
+	if (k->deinit != NULL)
+		k->deinit(state);
+	step_report(cpu, governor, cfg->sample_us, c);
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		step_run
+ * @BRIEF		run the DVFS step response probe.
+ * @RETURNS		0 on success, negative error code otherwise
+ * @param[in]		cpu_count: number of CPUs
+ * @param[in]		cpus: per-CPU load, CLG_LOAD_NONE: skip CPU
+ * @param[in]		cfg: step configuration
+ * @DESCRIPTION		run the DVFS step response probe on selected CPUs,
+ *			one CPU at a time so that CPUs sharing a frequency
+ *			domain do not interfere, and restore the calling
+ *			thread affinity.
+ *//*------------------------------------------------------------------------ */
+int step_run(unsigned int cpu_count, const int *cpus,
+	const struct step_config *cfg)
+{
+	const struct kernel *k;
+	const char *params;
+	char name[KERNEL_SPEC_MAX];
+	struct step_curve c;
+	cpu_set_t saved;
+	unsigned int cpu, probe;
+	double iter_ns;
+	int ret;
+
+	if ((cfg->busy_ms < 1) || (cfg->idle_ms < 1) || (cfg->steps < 1) ||
+		(cfg->sample_us < STEP_MIN_SAMPLE_US) ||
+		(cfg->sample_us > cfg->busy_ms * 1000) ||
+		(cfg->sample_us > cfg->idle_ms * 1000))
+		return -EINVAL;
+	ret = kernel_find(cfg->kernel, &k, &params);
+	if (ret != 0)
+		return ret;
+	kernel_spec(k, params, name, sizeof(name));
+	iter_ns = kernel_iteration_ns(k, params, &ret);
+	if (ret != 0)
+		return ret;
+	probe = (iter_ns < STEP_PROBE_NS) ?
+		(unsigned int) (STEP_PROBE_NS / iter_ns) : 1;
+
+	c.nbusy = cfg->busy_ms * 1000 / cfg->sample_us;
+	c.nidle = cfg->idle_ms * 1000 / cfg->sample_us;
+	c.busy = malloc(c.nbusy * sizeof(double));
+	c.idle = malloc(c.nidle * sizeof(double));
+	if ((c.busy == NULL) || (c.idle == NULL)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	if (sched_getaffinity(0, sizeof(saved), &saved) != 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	iprintf("Step response (kernel %s, %d x %ldms busy / %ldms idle, sampled every %ldus):\n",
+		name, cfg->steps, cfg->busy_ms, cfg->idle_ms, cfg->sample_us);
+	for (cpu = 0; cpu < cpu_count; cpu++) {
+		if (cpus[cpu] == CLG_LOAD_NONE)
+			continue;
+		ret = step_cpu(cpu, k, params, probe, cfg, &c);
+		if (ret != 0)
+			break;
+	}
+	iprintf("\n");
+	sched_setaffinity(0, sizeof(saved), &saved);
+
+out:
+	free(c.busy);
+	free(c.idle);
+	return ret;
+}
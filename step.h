@@ -0,0 +1,67 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			step.h
+ * @Description			DVFS step response probe
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __STEP_H__
+#define __STEP_H__
+
+#define STEP_DEFAULT_COUNT	5	/* busy/idle steps per CPU */
+#define STEP_DEFAULT_SAMPLE_US	500	/* iteration rate sampling period */
+#define STEP_MIN_SAMPLE_US	50
+#define STEP_PROBE_NS		5000	/* idle phase probe length */
+#define STEP_SETTLE		0.9	/* share of the swing to settle */
+#define STEP_FLAT		0.05	/* swing below: no DVFS response */
+
+/* Step response probe configuration */
+struct step_config {
+	long int busy_ms;	/* busy phase length */
+	long int idle_ms;	/* idle phase length */
+	int steps;		/* busy/idle steps per CPU */
+	long int sample_us;	/* iteration rate sampling period */
+	const char *kernel;	/* kernel spec, NULL: default */
+};
+
+
+int step_run(unsigned int cpu_count, const int *cpus,
+	const struct step_config *cfg);
+
+
+#endif
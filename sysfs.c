@@ -0,0 +1,157 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			sysfs.c
+ * @Description			sysfs access helpers
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "sysfs.h"
+
+
+static const char *sysfs_root = SYSFS_DEFAULT_ROOT;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sysfs_set_root
+ * @BRIEF		set sysfs root directory.
+ * @RETURNS		0 on success
+ *			-ENOTDIR if root is not a directory
+ * @param[in]		root: sysfs root directory (e.g. a fake tree)
+ * @DESCRIPTION		set sysfs root directory, "/sys" by default.
+ *			Allows telemetry to be exercised against a fake tree.
+ *//*------------------------------------------------------------------------ */
+int sysfs_set_root(const char *root)
+{
+	struct stat st;
+
+	if ((stat(root, &st) != 0) || !S_ISDIR(st.st_mode))
+		return -ENOTDIR;
+	sysfs_root = root;
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sysfs_get_root
+ * @BRIEF		return sysfs root directory.
+ * @RETURNS		sysfs root directory
+ * @DESCRIPTION		return sysfs root directory.
+ *//*------------------------------------------------------------------------ */
+const char *sysfs_get_root(void)
+{
+	return sysfs_root;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sysfs_path
+ * @BRIEF		build a sysfs path, relative to sysfs root.
+ * @RETURNS		0 on success, -ENAMETOOLONG if truncated
+ * @param[out]		buf: path
+ * @param[in]		size: buf size
+ * @param[in]		fmt: printf-like format of the relative path
+ * @DESCRIPTION		build a sysfs path, relative to sysfs root.
+ *//*------------------------------------------------------------------------ */
+int sysfs_path(char *buf, unsigned int size, const char *fmt, ...)
+{
+	va_list ap;
+	int n, m;
+
+	n = snprintf(buf, size, "%s/", sysfs_root);
+	if ((n < 0) || ((unsigned int) n >= size))
+		return -ENAMETOOLONG;
+	va_start(ap, fmt);
+	m = vsnprintf(buf + n, size - n, fmt, ap);
+	va_end(ap);
+	if ((m < 0) || ((unsigned int) (n + m) >= size))
+		return -ENAMETOOLONG;
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sysfs_read_ll
+ * @BRIEF		read an integer from a sysfs file.
+ * @RETURNS		value read, -1 in case of error
+ * @param[in]		path: sysfs file path
+ * @DESCRIPTION		read an integer from a sysfs file.
+ *//*------------------------------------------------------------------------ */
+long long sysfs_read_ll(const char *path)
+{
+	FILE *fp;
+	long long v;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return -1;
+	if (fscanf(fp, "%lld", &v) != 1)
+		v = -1;
+	fclose(fp);
+	return v;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		sysfs_read_str
+ * @BRIEF		read the first line of a sysfs file.
+ * @RETURNS		0 on success, -errno otherwise
+ * @param[in]		path: sysfs file path
+ * @param[out]		buf: line read, without trailing newline
+ * @param[in]		size: buf size
+ * @DESCRIPTION		read the first line of a sysfs file.
+ *//*------------------------------------------------------------------------ */
+int sysfs_read_str(const char *path, char *buf, unsigned int size)
+{
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return -errno;
+	if (fgets(buf, size, fp) == NULL) {
+		fclose(fp);
+		return -EIO;
+	}
+	fclose(fp);
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
@@ -0,0 +1,477 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			thermal.c
+ * @Description			Thermal and energy telemetry
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include "cpuloadgen.h"
+#include "clg.h"
+#include "sysfs.h"
+#include "output.h"
+#include "thermal.h"
+
+
+struct thermal_zone {
+	char key[THERMAL_NAME_MAX];	/* sysfs directory, unique */
+	char name[THERMAL_NAME_MAX];	/* zone type */
+	char path[SYSFS_PATH_MAX];	/* temp file */
+	long long first, last, min, max;	/* millidegree Celsius */
+};
+
+struct powercap_domain {
+	char key[THERMAL_NAME_MAX];	/* sysfs directory, unique */
+	char name[THERMAL_NAME_MAX];
+	char path[SYSFS_PATH_MAX];	/* energy_uj file */
+	long long max_range_uj;
+	long long last_uj;
+	uint64_t total_uj;
+	int top;	/* top-level (package) domain, not a subzone */
+};
+
+/* Energy and work accumulated at a given load level */
+struct energy_level {
+	uint64_t energy_uj;
+	uint64_t iterations;
+	uint64_t ns;
+};
+
+/* Kernel throughput tracking of a load thread */
+struct cpu_throughput {
+	int load;
+	unsigned int samples;
+	double ref;		/* best iterations per busy ns at this load */
+	int throttled;
+	unsigned int throttled_intervals;
+	double max_drop;	/* in % */
+};
+
+static struct thermal_zone zones[THERMAL_MAX_ZONES];
+static unsigned int zone_count = 0;
+static struct powercap_domain domains[POWERCAP_MAX_DOMAINS];
+static unsigned int domain_count = 0;
+static struct energy_level levels[101];
+static struct energy_level mixed;	/* threads at different loads */
+static struct cpu_throughput *tp = NULL;
+static unsigned int tp_count = 0;
+
+/* Accumulated over one reporting interval by thermal_throughput() */
+static uint64_t tick_iterations;
+static unsigned int tick_threads, tick_rates;
+static int tick_load, tick_mixed;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		thermal_discover
+ * @BRIEF		discover thermal zones and powercap domains.
+ * @DESCRIPTION		discover thermal zones and powercap domains under
+ *			the sysfs root.
+ *//*------------------------------------------------------------------------ */
+static void thermal_discover(void)
+{
+	char path[SYSFS_PATH_MAX];
+	struct thermal_zone *z;
+	struct powercap_domain *d;
+	struct dirent *de;
+	const char *p;
+	DIR *dir;
+	int colons;
+
+	sysfs_path(path, sizeof(path), SYSFS_THERMAL_PATH);
+	dir = opendir(path);
+	while ((dir != NULL) && ((de = readdir(dir)) != NULL) &&
+		(zone_count < THERMAL_MAX_ZONES)) {
+		if (strncmp(de->d_name, "thermal_zone", 12) != 0)
+			continue;
+		z = &zones[zone_count];
+		if (sysfs_path(z->path, sizeof(z->path),
+			SYSFS_THERMAL_PATH "/%s/temp", de->d_name) != 0)
+			continue;
+		z->first = sysfs_read_ll(z->path);
+		if (z->first < 0)
+			continue;
+		sysfs_path(path, sizeof(path), SYSFS_THERMAL_PATH "/%s/type",
+			de->d_name);
+		if (sysfs_read_str(path, z->name, sizeof(z->name)) != 0)
+			snprintf(z->name, sizeof(z->name), "%.*s",
+				(int) sizeof(z->name) - 1, de->d_name);
+		snprintf(z->key, sizeof(z->key), "%.*s",
+			(int) sizeof(z->key) - 1, de->d_name);
+		z->last = z->min = z->max = z->first;
+		zone_count++;
+	}
+	if (dir != NULL)
+		closedir(dir);
+
+	sysfs_path(path, sizeof(path), SYSFS_POWERCAP_PATH);
+	dir = opendir(path);
+	while ((dir != NULL) && ((de = readdir(dir)) != NULL) &&
+		(domain_count < POWERCAP_MAX_DOMAINS)) {
+		if (de->d_name[0] == '.')
+			continue;
+		d = &domains[domain_count];
+		if (sysfs_path(d->path, sizeof(d->path),
+			SYSFS_POWERCAP_PATH "/%s/energy_uj", de->d_name) != 0)
+			continue;
+		d->last_uj = sysfs_read_ll(d->path);
+		if (d->last_uj < 0)
+			continue;
+		sysfs_path(path, sizeof(path),
+			SYSFS_POWERCAP_PATH "/%s/max_energy_range_uj",
+			de->d_name);
+		d->max_range_uj = sysfs_read_ll(path);
+		sysfs_path(path, sizeof(path), SYSFS_POWERCAP_PATH "/%s/name",
+			de->d_name);
+		if (sysfs_read_str(path, d->name, sizeof(d->name)) != 0)
+			snprintf(d->name, sizeof(d->name), "%.*s",
+				(int) sizeof(d->name) - 1, de->d_name);
+		snprintf(d->key, sizeof(d->key), "%.*s",
+			(int) sizeof(d->key) - 1, de->d_name);
+		/* "intel-rapl:0" is a package, "intel-rapl:0:1" a subzone */
+		for (colons = 0, p = de->d_name; *p != '\0'; p++)
+			colons += (*p == ':');
+		d->top = (colons <= 1);
+		d->total_uj = 0;
+		domain_count++;
+	}
+	if (dir != NULL)
+		closedir(dir);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		thermal_init
+ * @BRIEF		enable thermal and energy telemetry.
+ * @RETURNS		0 on success
+ *			-ENOMEM in case of allocation failure
+ * @param[in]		count: number of CPU cores
+ * @DESCRIPTION		enable thermal and energy telemetry.
+ *			Missing thermal zones or powercap domains are not
+ *			an error: the related reports are just empty.
+ *//*------------------------------------------------------------------------ */
+int thermal_init(unsigned int count)
+{
+	tp = calloc(count, sizeof(struct cpu_throughput));
+	if (tp == NULL)
+		return -ENOMEM;
+	tp_count = count;
+	memset(levels, 0, sizeof(levels));
+	memset(&mixed, 0, sizeof(mixed));
+	thermal_discover();
+	if ((zone_count == 0) && (domain_count == 0))
+		fprintf(stderr,
+			"cpuloadgen: no thermal zone nor powercap domain found under %s.\n",
+			sysfs_get_root());
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		thermal_enabled
+ * @BRIEF		tell whether thermal telemetry is enabled.
+ * @RETURNS		1 if enabled, 0 otherwise
+ * @DESCRIPTION		tell whether thermal telemetry is enabled.
+ *//*------------------------------------------------------------------------ */
+int thermal_enabled(void)
+{
+	return tp != NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		thermal_throughput
+ * @BRIEF		account one interval of kernel work of a load thread.
+ * @param[in]		t: elapsed time (in seconds)
+ * @param[in]		cpu: CPU core ID
+ * @param[in]		load: target load
+ * @param[in]		iterations: kernel iterations over the interval
+ * @param[in]		busy_ns: busy time over the interval
+ * @DESCRIPTION		account one interval of kernel work of a load thread,
+ *			for energy per work, and detect throttling: at an
+ *			unchanged duty cycle, a drop of kernel throughput
+ *			per busy second means the CPU got slower.
+ *			Throughput targets (CLG_LOAD_RATE) have no load
+ *			level: an interval with such threads is not
+ *			credited to any energy level, nor one with threads
+ *			at different loads.
+ *//*------------------------------------------------------------------------ */
+void thermal_throughput(double t, unsigned int cpu, int load,
+	uint64_t iterations, uint64_t busy_ns)
+{
+	struct cpu_throughput *c;
+	double speed, drop;
+
+	if ((tp == NULL) || (cpu >= tp_count))
+		return;
+	tick_iterations += iterations;
+	if (load == CLG_LOAD_RATE) {
+		tick_rates++;
+	} else {
+		if ((tick_threads != 0) && (load != tick_load))
+			tick_mixed = 1;
+		tick_load = load;
+		tick_threads++;
+	}
+
+	if (busy_ns == 0)
+		return;
+	c = &tp[cpu];
+	if (c->load != load) {
+		c->load = load;
+		c->samples = 0;
+		c->ref = 0.0;
+		c->throttled = 0;
+	}
+	speed = (double) iterations / (double) busy_ns;
+	c->samples++;
+	if ((c->samples <= THROTTLE_WARMUP) || (speed > c->ref)) {
+		if (speed > c->ref)
+			c->ref = speed;
+		c->throttled = 0;
+		return;
+	}
+
+	drop = 100.0 * (c->ref - speed) / c->ref;
+	if (drop < THROTTLE_DROP_PCT) {
+		c->throttled = 0;
+		return;
+	}
+	c->throttled_intervals++;
+	if (drop > c->max_drop)
+		c->max_drop = drop;
+	if (c->throttled)
+		return;
+	c->throttled = 1;
+	if (load == CLG_LOAD_RATE)
+		iprintf("[%8.2fs] CPU%u: kernel throughput dropped by %.1f%% at constant throughput target, thermal throttling suspected!\n",
+			t, cpu, drop);
+	else
+		iprintf("[%8.2fs] CPU%u: kernel throughput dropped by %.1f%% at constant %d%% load, thermal throttling suspected!\n",
+			t, cpu, drop, load);
+	output_begin("throttle");
+	output_field_double("t", t);
+	output_field_int("cpu", cpu);
+	if (load == CLG_LOAD_RATE)
+		output_field_null("load");
+	else
+		output_field_int("load", load);
+	output_field_double("drop_pct", drop);
+	output_end();
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		thermal_sample
+ * @BRIEF		sample temperatures and energy counters.
+ * @param[in]		t: elapsed time (in seconds)
+ * @param[in]		period_ns: interval duration (in ns)
+ * @param[in]		print: print values if != 0
+ * @DESCRIPTION		sample temperatures and energy counters, once per
+ *			reporting interval, after thermal_throughput() was
+ *			called for each load thread. Energy is credited to
+ *			the target load of the interval when all threads
+ *			shared it: package energy cannot be split between
+ *			threads at different loads (or with a throughput
+ *			target), so such intervals are only accounted as
+ *			mixed.
+ *//*------------------------------------------------------------------------ */
+void thermal_sample(double t, uint64_t period_ns, int print)
+{
+	struct powercap_domain *d;
+	struct thermal_zone *z;
+	struct energy_level *lvl;
+	uint64_t delta, energy = 0;
+	long long v;
+	unsigned int i;
+
+	if (tp == NULL)
+		return;
+
+	output_begin("thermal");
+	output_field_double("t", t);
+	if (print)
+		iprintf("%12s thermal:", "");
+	for (i = 0; i < zone_count; i++) {
+		z = &zones[i];
+		v = sysfs_read_ll(z->path);
+		output_field_int(z->key, v);
+		if (v < 0)
+			continue;
+		z->last = v;
+		if (v < z->min)
+			z->min = v;
+		if (v > z->max)
+			z->max = v;
+		if (print)
+			iprintf(" %s %.1fC", z->name, (double) v / 1000.0);
+	}
+	for (i = 0; i < domain_count; i++) {
+		d = &domains[i];
+		v = sysfs_read_ll(d->path);
+		delta = 0;
+		if (v >= d->last_uj)
+			delta = v - d->last_uj;
+		else if (v >= 0)	/* counter wrapped */
+			delta = d->max_range_uj - d->last_uj + v;
+		if (v >= 0)
+			d->last_uj = v;
+		d->total_uj += delta;
+		if (d->top)
+			energy += delta;
+		output_field_u64(d->key, delta);
+		if (print && (period_ns != 0))
+			iprintf(" %s %.2fW", d->name,
+				(double) delta * 1.0e3 / period_ns);
+	}
+	if (print)
+		iprintf("\n");
+	output_end();
+
+	if ((tick_threads != 0) || (tick_rates != 0)) {
+		lvl = (tick_mixed || (tick_rates != 0)) ?
+			&mixed : &levels[tick_load];
+		lvl->energy_uj += energy;
+		lvl->iterations += tick_iterations;
+		lvl->ns += period_ns;
+	}
+	tick_iterations = 0;
+	tick_threads = tick_rates = 0;
+	tick_mixed = 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		thermal_report
+ * @BRIEF		print and emit thermal and energy summary.
+ * @DESCRIPTION		print and emit thermal and energy summary:
+ *			temperature range per zone, energy per domain,
+ *			energy per unit of kernel work per load level (and
+ *			over intervals of mixed loads, as load null) and
+ *			throttling episodes.
+ *//*------------------------------------------------------------------------ */
+void thermal_report(void)
+{
+	struct energy_level *lvl;
+	unsigned int i;
+
+	if (tp == NULL)
+		return;
+
+	iprintf("\nThermal summary:\n");
+	for (i = 0; i < zone_count; i++) {
+		iprintf("\t%-16s: start %.1fC end %.1fC min %.1fC max %.1fC\n",
+			zones[i].name, zones[i].first / 1000.0,
+			zones[i].last / 1000.0, zones[i].min / 1000.0,
+			zones[i].max / 1000.0);
+		output_begin("thermal_zone");
+		output_field_str("zone", zones[i].key);
+		output_field_str("name", zones[i].name);
+		output_field_int("first_mc", zones[i].first);
+		output_field_int("last_mc", zones[i].last);
+		output_field_int("min_mc", zones[i].min);
+		output_field_int("max_mc", zones[i].max);
+		output_end();
+	}
+	for (i = 0; i < domain_count; i++) {
+		iprintf("\t%-16s: %.3fJ\n", domains[i].name,
+			domains[i].total_uj / 1.0e6);
+		output_begin("energy_domain");
+		output_field_str("domain", domains[i].key);
+		output_field_str("name", domains[i].name);
+		output_field_int("top", domains[i].top);
+		output_field_u64("energy_uj", domains[i].total_uj);
+		output_end();
+	}
+
+	for (i = 0; i <= 100; i++) {
+		lvl = &levels[i];
+		if (lvl->ns == 0)
+			continue;
+		output_begin("energy_per_work");
+		output_field_int("load", i);
+		output_field_u64("ns", lvl->ns);
+		output_field_u64("energy_uj", lvl->energy_uj);
+		output_field_u64("iterations", lvl->iterations);
+		output_end();
+		if ((domain_count == 0) || (lvl->iterations == 0))
+			continue;
+		iprintf("\t%3u%% load: %.2fW, %.3fJ per Giteration\n", i,
+			lvl->energy_uj * 1.0e3 / lvl->ns,
+			lvl->energy_uj * 1.0e3 / lvl->iterations);
+	}
+	if (mixed.ns != 0) {
+		output_begin("energy_per_work");
+		output_field_null("load");
+		output_field_u64("ns", mixed.ns);
+		output_field_u64("energy_uj", mixed.energy_uj);
+		output_field_u64("iterations", mixed.iterations);
+		output_end();
+		if ((domain_count != 0) && (mixed.iterations != 0))
+			iprintf("\tmixed load: %.2fW, %.3fJ per Giteration\n",
+				mixed.energy_uj * 1.0e3 / mixed.ns,
+				mixed.energy_uj * 1.0e3 / mixed.iterations);
+	}
+
+	for (i = 0; i < tp_count; i++) {
+		if (tp[i].throttled_intervals == 0)
+			continue;
+		iprintf("\tCPU%u: throttling suspected during %u interval(s), max throughput drop %.1f%%\n",
+			i, tp[i].throttled_intervals, tp[i].max_drop);
+	}
+	fflush(output_info_stream());
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		thermal_deinit
+ * @BRIEF		free thermal telemetry buffers.
+ * @DESCRIPTION		free thermal telemetry buffers.
+ *//*------------------------------------------------------------------------ */
+void thermal_deinit(void)
+{
+	free(tp);
+	tp = NULL;
+	tp_count = 0;
+	zone_count = domain_count = 0;
+}
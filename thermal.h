@@ -0,0 +1,71 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			thermal.h
+ * @Description			Thermal and energy telemetry
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __THERMAL_H__
+#define __THERMAL_H__
+
+#include <stdint.h>
+
+#define THERMAL_MAX_ZONES	32
+#define POWERCAP_MAX_DOMAINS	16
+#define THERMAL_NAME_MAX	32
+
+/*
+ * Kernel throughput (iterations per busy second) dropping by more than
+ * THROTTLE_DROP_PCT below its best value at an unchanged target load is
+ * reported as suspected thermal throttling. The first THROTTLE_WARMUP
+ * intervals at a given load only establish the reference.
+ */
+#define THROTTLE_DROP_PCT	10
+#define THROTTLE_WARMUP		2
+
+
+int thermal_init(unsigned int count);
+int thermal_enabled(void);
+void thermal_throughput(double t, unsigned int cpu, int load,
+	uint64_t iterations, uint64_t busy_ns);
+void thermal_sample(double t, uint64_t period_ns, int print);
+void thermal_report(void);
+void thermal_deinit(void);
+
+
+#endif
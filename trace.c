@@ -0,0 +1,353 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			trace.c
+ * @Description			Per-thread binary event trace (memory-mapped ring buffers)
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cpuloadgen.h"
+#include "trace.h"
+
+
+static struct trace_ring *rings = NULL;
+static unsigned int ring_count = 0;
+static char *trace_prefix = NULL;
+static uint64_t trace_capacity;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		trace_init
+ * @BRIEF		enable per-thread event tracing.
+ * @RETURNS		0 on success
+ *			-EINVAL in case of invalid ring size
+ *			-ENOMEM in case of allocation failure
+ * @param[in]		count: number of CPU cores
+ * @param[in]		prefix: trace files prefix
+ *				(files are named <prefix>.cpu<n>.trace)
+ * @param[in]		events: ring capacity, in events (rounded up to a
+ *				power of 2)
+ * @DESCRIPTION		enable per-thread event tracing.
+ *//*------------------------------------------------------------------------ */
+int trace_init(unsigned int count, const char *prefix, unsigned long events)
+{
+	unsigned int i;
+
+	if ((events == 0) || (events > (1UL << 30)))
+		return -EINVAL;
+	trace_capacity = 1;
+	while (trace_capacity < events)
+		trace_capacity <<= 1;
+
+	rings = calloc(count, sizeof(struct trace_ring));
+	trace_prefix = strdup(prefix);
+	if ((rings == NULL) || (trace_prefix == NULL)) {
+		trace_deinit();
+		return -ENOMEM;
+	}
+	for (i = 0; i < count; i++)
+		rings[i].fd = -1;
+	ring_count = count;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		trace_open
+ * @BRIEF		create and map the trace file of a CPU.
+ * @RETURNS		0 on success
+ *			-EINVAL if tracing is not enabled
+ *			-errno in case of file error
+ * @param[in]		cpu: CPU core ID
+ * @DESCRIPTION		create and map the trace file of a CPU.
+ *			The mapping is pre-faulted, so that load threads do
+ *			not take page faults while tracing.
+ *//*------------------------------------------------------------------------ */
+int trace_open(unsigned int cpu)
+{
+	struct trace_ring *r;
+	char path[512];
+	void *map;
+	int ret;
+
+	if ((rings == NULL) || (cpu >= ring_count))
+		return -EINVAL;
+	r = &rings[cpu];
+
+	snprintf(path, sizeof(path), "%s.cpu%u.trace", trace_prefix, cpu);
+	r->map_size = sizeof(struct trace_header) +
+		trace_capacity * sizeof(struct trace_event);
+	r->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (r->fd < 0)
+		return -errno;
+	if (ftruncate(r->fd, r->map_size) != 0)
+		goto err;
+	map = mmap(NULL, r->map_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, r->fd, 0);
+	if (map == MAP_FAILED)
+		goto err;
+
+	r->hdr = map;
+	r->ev = (struct trace_event *) (r->hdr + 1);
+	r->mask = trace_capacity - 1;
+	r->head = 0;
+	r->cpu = cpu;
+	r->hdr->magic = TRACE_MAGIC;
+	r->hdr->version = TRACE_VERSION;
+	r->hdr->cpu = cpu;
+	r->hdr->event_size = sizeof(struct trace_event);
+	r->hdr->capacity = trace_capacity;
+	r->hdr->head = 0;
+
+	return 0;
+
+err:
+	ret = -errno;
+	close(r->fd);
+	r->fd = -1;
+	return ret;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		trace_ring_get
+ * @BRIEF		return the ring buffer of a CPU.
+ * @RETURNS		ring buffer, NULL if tracing is disabled for that CPU
+ * @param[in]		cpu: CPU core ID
+ * @DESCRIPTION		return the ring buffer of a CPU.
+ *//*------------------------------------------------------------------------ */
+struct trace_ring *trace_ring_get(unsigned int cpu)
+{
+	if ((rings == NULL) || (cpu >= ring_count) || (rings[cpu].hdr == NULL))
+		return NULL;
+	return &rings[cpu];
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		trace_deinit
+ * @BRIEF		unmap and close all trace files.
+ * @DESCRIPTION		unmap and close all trace files.
+ *			Must not be called while load threads are running.
+ *//*------------------------------------------------------------------------ */
+void trace_deinit(void)
+{
+	unsigned int i;
+
+	for (i = 0; (rings != NULL) && (i < ring_count); i++) {
+		if (rings[i].hdr != NULL) {
+			msync(rings[i].hdr, rings[i].map_size, MS_ASYNC);
+			munmap(rings[i].hdr, rings[i].map_size);
+		}
+		if (rings[i].fd >= 0)
+			close(rings[i].fd);
+	}
+	free(rings);
+	free(trace_prefix);
+	rings = NULL;
+	trace_prefix = NULL;
+	ring_count = 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		trace_export_file
+ * @BRIEF		convert one trace file into Chrome trace events.
+ * @RETURNS		0 on success
+ *			-errno in case of file error
+ *			-EINVAL in case of invalid trace file
+ * @param[in]		path: trace file
+ * @param[in,out]	out: output JSON stream
+ * @param[in,out]	first: 1 if no event was written yet
+ * @DESCRIPTION		convert one trace file into Chrome trace events:
+ *			busy and idle slices as complete ("X") events,
+ *			overshoots and retargets as instant ("i") events.
+ *			Timestamps are CLOCK_MONOTONIC, in us.
+ *//*------------------------------------------------------------------------ */
+static int trace_export_file(const char *path, FILE *out, int *first)
+{
+	const struct trace_header *hdr;
+	const struct trace_event *ev, *e;
+	struct stat st;
+	uint64_t i, start, frame_ts = 0, busy_ts = 0, frame = 0, iterations = 0;
+	int fd, ret = 0, in_frame = 0, in_idle = 0;
+	void *map;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	if ((fstat(fd, &st) != 0) ||
+		(st.st_size < (off_t) sizeof(struct trace_header))) {
+		close(fd);
+		return -EINVAL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -errno;
+
+	hdr = map;
+	if ((hdr->magic != TRACE_MAGIC) || (hdr->version != TRACE_VERSION) ||
+		(hdr->event_size != sizeof(struct trace_event)) ||
+		(hdr->capacity == 0) ||
+		((hdr->capacity & (hdr->capacity - 1)) != 0) ||
+		((uint64_t) st.st_size < sizeof(struct trace_header) +
+		hdr->capacity * sizeof(struct trace_event))) {
+		ret = -EINVAL;
+		goto out;
+	}
+	ev = (const struct trace_event *) (hdr + 1);
+
+#define SEP	(*first ? (*first = 0, "") : ",\n")
+	fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"CPU%u\"}}",
+		SEP, hdr->cpu, hdr->cpu);
+	start = (hdr->head > hdr->capacity) ? hdr->head - hdr->capacity : 0;
+	for (i = start; i < hdr->head; i++) {
+		e = &ev[i & (hdr->capacity - 1)];
+		switch (e->type) {
+		case TRACE_FRAME_START:
+			frame_ts = e->ts_ns;
+			frame = e->arg;
+			in_frame = 1;
+			in_idle = 0;
+			break;
+		case TRACE_BUSY_END:
+			iterations = e->arg;
+			busy_ts = e->ts_ns;
+			if (!in_frame)
+				break;
+			fprintf(out, "%s{\"name\":\"busy\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu,\"iterations\":%llu}}",
+				SEP, e->cpu, frame_ts / 1.0e3,
+				(e->ts_ns - frame_ts) / 1.0e3,
+				(unsigned long long) frame,
+				(unsigned long long) iterations);
+			in_idle = 1;
+			break;
+		case TRACE_IDLE_END:
+			if (!in_idle)
+				break;
+			fprintf(out, "%s{\"name\":\"idle\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu,\"requested_us\":%.3f}}",
+				SEP, e->cpu, busy_ts / 1.0e3,
+				(e->ts_ns - busy_ts) / 1.0e3,
+				(unsigned long long) frame, e->arg / 1.0e3);
+			in_idle = 0;
+			in_frame = 0;
+			break;
+		case TRACE_OVERSHOOT:
+			fprintf(out, "%s{\"name\":\"overshoot\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"overshoot_us\":%.3f}}",
+				SEP, e->cpu, e->ts_ns / 1.0e3, e->arg / 1.0e3);
+			break;
+		case TRACE_RETARGET:
+			fprintf(out, "%s{\"name\":\"retarget\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"load\":%llu}}",
+				SEP, e->cpu, e->ts_ns / 1.0e3,
+				(unsigned long long) e->arg);
+			break;
+		default:
+			break;
+		}
+	}
+#undef SEP
+
+out:
+	munmap(map, st.st_size);
+	return ret;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		trace_export_chrome
+ * @BRIEF		convert trace files into a Chrome trace JSON file.
+ * @RETURNS		0 on success
+ *			-ENOENT if no trace file matches prefix
+ *			-errno in case of file error
+ * @param[in]		prefix: trace files prefix, as given to trace_init()
+ * @param[in]		path: output file, NULL or "-" for stdout
+ * @DESCRIPTION		convert all <prefix>.cpu<n>.trace files into a
+ *			single Chrome trace JSON file (also loadable by
+ *			Perfetto UI), one track per CPU.
+ *//*------------------------------------------------------------------------ */
+int trace_export_chrome(const char *prefix, const char *path)
+{
+	char pattern[512];
+	glob_t g;
+	FILE *out;
+	size_t i;
+	int first = 0, ret;
+
+	snprintf(pattern, sizeof(pattern), "%s.cpu*.trace", prefix);
+	if (glob(pattern, 0, NULL, &g) != 0)
+		return -ENOENT;
+
+	if ((path == NULL) || (strcmp(path, "-") == 0)) {
+		out = stdout;
+	} else {
+		out = fopen(path, "w");
+		if (out == NULL) {
+			ret = -errno;
+			globfree(&g);
+			return ret;
+		}
+	}
+
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"clock\":\"CLOCK_MONOTONIC\"},\"traceEvents\":[\n");
+	fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"cpuloadgen\"}}");
+	for (i = 0; i < g.gl_pathc; i++) {
+		ret = trace_export_file(g.gl_pathv[i], out, &first);
+		if (ret != 0)
+			fprintf(stderr, "cpuloadgen: skipping %s (%d)\n",
+				g.gl_pathv[i], ret);
+	}
+	fprintf(out, "\n]}\n");
+
+	globfree(&g);
+	if (out != stdout)
+		fclose(out);
+	else
+		fflush(out);
+
+	return 0;
+}
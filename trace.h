@@ -0,0 +1,127 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			trace.h
+ * @Description			Per-thread binary event trace (memory-mapped ring buffers)
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+#define TRACE_MAGIC		0x54474c43	/* "CLGT" */
+#define TRACE_VERSION		1
+#define TRACE_DEFAULT_EVENTS	(1 << 20)
+
+typedef enum {
+	TRACE_FRAME_START = 1,	/* arg: frame number */
+	TRACE_BUSY_END,		/* arg: kernel iterations of the busy slice */
+	TRACE_IDLE_END,		/* arg: requested idle time (ns) */
+	TRACE_OVERSHOOT,	/* arg: idle overshoot (ns) */
+	TRACE_RETARGET		/* arg: new target load */
+} trace_event_type;
+
+/* Fixed-size event, as stored in the trace file */
+struct trace_event {
+	uint64_t ts_ns;		/* CLOCK_MONOTONIC */
+	uint32_t type;
+	uint32_t cpu;
+	uint64_t arg;
+	uint64_t reserved;
+};
+
+/* Trace file header, followed by capacity events */
+struct trace_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t cpu;
+	uint32_t event_size;
+	uint64_t capacity;	/* power of 2 */
+	uint64_t head;		/* events written so far (may exceed capacity) */
+	uint8_t pad[32];
+};
+
+struct trace_ring {
+	struct trace_header *hdr;
+	struct trace_event *ev;
+	uint64_t mask;
+	uint64_t head;
+	uint32_t cpu;
+	int fd;
+	size_t map_size;
+};
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		trace_emit
+ * @BRIEF		append an event to a thread's ring buffer.
+ * @param[in,out]	r: ring owned by the calling thread (NULL: no-op)
+ * @param[in]		type: event type
+ * @param[in]		ts: event timestamp (ns, CLOCK_MONOTONIC)
+ * @param[in]		arg: event argument
+ * @DESCRIPTION		append an event to a thread's ring buffer.
+ *			A few stores into a pre-faulted shared mapping: cheap
+ *			enough to be called several times per frame. Oldest
+ *			events are overwritten when the ring is full.
+ *//*------------------------------------------------------------------------ */
+static inline void trace_emit(struct trace_ring *r, uint32_t type, uint64_t ts,
+	uint64_t arg)
+{
+	struct trace_event *e;
+
+	if (r == NULL)
+		return;
+	e = &r->ev[r->head & r->mask];
+	e->ts_ns = ts;
+	e->type = type;
+	e->cpu = r->cpu;
+	e->arg = arg;
+	r->head++;
+	__atomic_store_n(&r->hdr->head, r->head, __ATOMIC_RELEASE);
+}
+
+
+int trace_init(unsigned int count, const char *prefix, unsigned long events);
+int trace_open(unsigned int cpu);
+struct trace_ring *trace_ring_get(unsigned int cpu);
+void trace_deinit(void);
+int trace_export_chrome(const char *prefix, const char *path);
+
+
+#endif
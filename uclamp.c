@@ -0,0 +1,411 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			uclamp.c
+ * @Description			Per-thread utilization clamping and placement
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include "cpuloadgen.h"
+#include "output.h"
+#include "sysfs.h"
+#include "uclamp.h"
+
+/* Not exposed by every libc */
+#ifndef SCHED_FLAG_KEEP_POLICY
+#define SCHED_FLAG_KEEP_POLICY		0x08
+#endif
+#ifndef SCHED_FLAG_KEEP_PARAMS
+#define SCHED_FLAG_KEEP_PARAMS		0x10
+#endif
+#ifndef SCHED_FLAG_UTIL_CLAMP_MIN
+#define SCHED_FLAG_UTIL_CLAMP_MIN	0x20
+#endif
+#ifndef SCHED_FLAG_UTIL_CLAMP_MAX
+#define SCHED_FLAG_UTIL_CLAMP_MAX	0x40
+#endif
+
+/* SCHED_ATTR_SIZE_VER1 layout */
+struct uclamp_sched_attr {
+	uint32_t size;
+	uint32_t sched_policy;
+	uint64_t sched_flags;
+	int32_t sched_nice;
+	uint32_t sched_priority;
+	uint64_t sched_runtime;
+	uint64_t sched_deadline;
+	uint64_t sched_period;
+	uint32_t sched_util_min;
+	uint32_t sched_util_max;
+};
+
+static struct uclamp_thread *uthreads = NULL;
+static unsigned int ucount = 0;
+
+static pthread_t sampler;
+static int sampler_running = 0;
+static int sampler_stop;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_init
+ * @BRIEF		allocate per-thread clamps and placement accounting.
+ * @RETURNS		0 on success, -ENOMEM otherwise
+ * @param[in]		count: number of CPU cores
+ * @DESCRIPTION		allocate per-thread clamps and placement accounting.
+ *			No clamp is set until uclamp_set() is called.
+ *//*------------------------------------------------------------------------ */
+int uclamp_init(unsigned int count)
+{
+	unsigned int i;
+
+	if (uthreads != NULL)
+		return 0;
+	if (posix_memalign((void **) &uthreads, STATS_CACHELINE_SIZE,
+		count * sizeof(struct uclamp_thread)) != 0) {
+		uthreads = NULL;
+		return -ENOMEM;
+	}
+	memset(uthreads, 0, count * sizeof(struct uclamp_thread));
+	ucount = count;
+	for (i = 0; i < count; i++) {
+		uthreads[i].min = -1;
+		uthreads[i].max = -1;
+		uthreads[i].got_min = -1;
+		uthreads[i].got_max = -1;
+		uthreads[i].cpu = -1;
+		uthreads[i].busy_ns = calloc(count, sizeof(uint64_t));
+		if (uthreads[i].busy_ns == NULL) {
+			uclamp_deinit();
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_set
+ * @BRIEF		set the utilization clamps of a load thread.
+ * @RETURNS		0 on success, -EINVAL in case of invalid argument
+ * @param[in]		cpu: CPU core ID of the load thread
+ * @param[in]		min: minimum utilization ([0-UCLAMP_SCALE])
+ * @param[in]		max: maximum utilization ([min-UCLAMP_SCALE])
+ * @DESCRIPTION		set the utilization clamps of a load thread, applied
+ *			when it starts. Independent of its load.
+ *//*------------------------------------------------------------------------ */
+int uclamp_set(unsigned int cpu, int min, int max)
+{
+	if ((uthreads == NULL) || (cpu >= ucount) || (min < 0) ||
+		(max < min) || (max > UCLAMP_SCALE))
+		return -EINVAL;
+	uthreads[cpu].min = min;
+	uthreads[cpu].max = max;
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_enabled
+ * @BRIEF		tell whether clamps and placement are tracked.
+ * @RETURNS		1 if enabled, 0 otherwise
+ * @DESCRIPTION		tell whether clamps and placement are tracked.
+ *//*------------------------------------------------------------------------ */
+int uclamp_enabled(void)
+{
+	return uthreads != NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_get
+ * @BRIEF		return the clamps and placement of a load thread.
+ * @RETURNS		load thread clamps, NULL if disabled
+ * @param[in]		cpu: CPU core ID of the load thread
+ * @DESCRIPTION		return the clamps and placement of a load thread.
+ *//*------------------------------------------------------------------------ */
+struct uclamp_thread *uclamp_get(unsigned int cpu)
+{
+	if ((uthreads == NULL) || (cpu >= ucount))
+		return NULL;
+	return &uthreads[cpu];
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_place
+ * @BRIEF		account a busy slice to the CPU it ran on.
+ * @param[in,out]	u: load thread clamps (NULL: no-op)
+ * @param[in]		busy_ns: busy slice duration
+ * @DESCRIPTION		account a busy slice to the CPU it ran on (as seen at
+ *			its end), counting migrations. Called by the load
+ *			thread once per frame.
+ *//*------------------------------------------------------------------------ */
+void uclamp_place(struct uclamp_thread *u, uint64_t busy_ns)
+{
+	int cpu;
+
+	if (u == NULL)
+		return;
+	cpu = sched_getcpu();
+	if ((cpu < 0) || ((unsigned int) cpu >= ucount))
+		return;
+	if ((u->cpu != -1) && (u->cpu != cpu))
+		u->migrations++;
+	__atomic_store_n(&u->cpu, cpu, __ATOMIC_RELAXED);
+	u->busy_ns[cpu] += busy_ns;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_thread_apply
+ * @BRIEF		apply the clamps of the calling load thread.
+ * @RETURNS		0 on success (or if no clamp is set)
+ *			-EINVAL in case of invalid cpu
+ *			-errno in case of sched_setattr() failure
+ * @param[in]		cpu: CPU core ID the calling thread loads
+ * @DESCRIPTION		apply the clamps of the calling load thread with
+ *			sched_setattr(), keeping its scheduling policy and
+ *			parameters, then read them back. Requires a kernel
+ *			built with CONFIG_UCLAMP_TASK.
+ *//*------------------------------------------------------------------------ */
+int uclamp_thread_apply(unsigned int cpu)
+{
+	struct uclamp_thread *u = uclamp_get(cpu);
+	struct uclamp_sched_attr attr;
+
+	if (u == NULL)
+		return -EINVAL;
+	if (u->min == -1)
+		return 0;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.sched_flags = SCHED_FLAG_KEEP_POLICY | SCHED_FLAG_KEEP_PARAMS |
+		SCHED_FLAG_UTIL_CLAMP_MIN | SCHED_FLAG_UTIL_CLAMP_MAX;
+	attr.sched_util_min = u->min;
+	attr.sched_util_max = u->max;
+	if (syscall(__NR_sched_setattr, 0, &attr, 0) != 0)
+		u->err = -errno;
+
+	memset(&attr, 0, sizeof(attr));
+	if (syscall(__NR_sched_getattr, 0, &attr, sizeof(attr), 0) == 0 &&
+		(attr.size >= sizeof(attr))) {
+		u->got_min = attr.sched_util_min;
+		u->got_max = attr.sched_util_max;
+	}
+
+	return u->err;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_sampler
+ * @BRIEF		frequency sampler thread.
+ * @param[in]		arg: unused
+ * @DESCRIPTION		frequency sampler thread: every UCLAMP_PERIOD_MS,
+ *			sample the frequency of the CPU each load thread
+ *			last ran on.
+ *//*------------------------------------------------------------------------ */
+static void *uclamp_sampler(void *arg UNUSED)
+{
+	char path[SYSFS_PATH_MAX];
+	struct timespec ts;
+	uint64_t next;
+	unsigned int i;
+	long long khz;
+	int cpu;
+
+	next = now_ns();
+	while (!__atomic_load_n(&sampler_stop, __ATOMIC_ACQUIRE)) {
+		for (i = 0; i < ucount; i++) {
+			cpu = __atomic_load_n(&uthreads[i].cpu,
+				__ATOMIC_RELAXED);
+			if (cpu < 0)
+				continue;
+			sysfs_path(path, sizeof(path), SYSFS_CPU_PATH
+				"/cpu%d/cpufreq/scaling_cur_freq", cpu);
+			khz = sysfs_read_ll(path);
+			if (khz <= 0)
+				continue;
+			uthreads[i].khz_sum += khz;
+			uthreads[i].khz_samples++;
+		}
+		next += UCLAMP_PERIOD_MS * 1000000ULL;
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	}
+
+	return NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_start
+ * @BRIEF		start the frequency sampler thread.
+ * @RETURNS		0 on success, pthread error code otherwise
+ * @DESCRIPTION		start the frequency sampler thread.
+ *			To be called once load threads are started.
+ *//*------------------------------------------------------------------------ */
+int uclamp_start(void)
+{
+	int ret;
+
+	if (uthreads == NULL)
+		return 0;
+	sampler_stop = 0;
+	ret = pthread_create(&sampler, NULL, uclamp_sampler, NULL);
+	if (ret != 0)
+		return ret;
+	sampler_running = 1;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_stop
+ * @BRIEF		stop the frequency sampler thread.
+ * @DESCRIPTION		stop the frequency sampler thread.
+ *//*------------------------------------------------------------------------ */
+void uclamp_stop(void)
+{
+	if (!sampler_running)
+		return;
+	__atomic_store_n(&sampler_stop, 1, __ATOMIC_RELEASE);
+	pthread_join(sampler, NULL);
+	sampler_running = 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_report
+ * @BRIEF		print and emit clamps, placement and frequency.
+ * @param[in]		secs: run duration (in seconds)
+ * @DESCRIPTION		print and emit, per load thread: requested and
+ *			effective clamps, share of busy time per CPU it ran
+ *			on, migrations and mean frequency of the CPU it was
+ *			on. Must be called once load threads and the sampler
+ *			are stopped.
+ *//*------------------------------------------------------------------------ */
+void uclamp_report(double secs)
+{
+	struct uclamp_thread *u;
+	unsigned int i, c;
+	uint64_t total;
+	char key[24];
+
+	if (uthreads == NULL)
+		return;
+
+	iprintf("\nUtilization clamps and placement:\n");
+	for (i = 0; i < ucount; i++) {
+		u = &uthreads[i];
+		if (u->cpu == -1)
+			continue;
+		total = 0;
+		for (c = 0; c < ucount; c++)
+			total += u->busy_ns[c];
+
+		output_begin("uclamp");
+		output_field_int("cpu", i);
+		output_field_int("util_min", u->min);
+		output_field_int("util_max", u->max);
+		output_field_int("error", u->err);
+		output_field_int("effective_min", u->got_min);
+		output_field_int("effective_max", u->got_max);
+		output_field_u64("migrations", u->migrations);
+		output_field_double("mean_khz", u->khz_samples ?
+			u->khz_sum / u->khz_samples : 0.0);
+		for (c = 0; c < ucount; c++) {
+			snprintf(key, sizeof(key), "busy_ns_cpu%u", c);
+			output_field_u64(key, u->busy_ns[c]);
+		}
+		output_end();
+
+		iprintf("\tthread %u: ", i);
+		if (u->min == -1)
+			iprintf("no clamp");
+		else if (u->err != 0)
+			iprintf("clamp %d-%d could not be set (%d)", u->min,
+				u->max, u->err);
+		else
+			iprintf("clamp %d-%d (effective %d-%d)", u->min, u->max,
+				u->got_min, u->got_max);
+		if (u->khz_samples != 0)
+			iprintf(", mean frequency %.0f MHz",
+				u->khz_sum / u->khz_samples / 1000.0);
+		iprintf(", %.1f migrations/s\n\t\tbusy time:",
+			secs > 0.0 ? u->migrations / secs : 0.0);
+		for (c = 0; c < ucount; c++)
+			if (u->busy_ns[c] != 0)
+				iprintf(" CPU%u %.1f%%", c,
+					100.0 * u->busy_ns[c] / total);
+		iprintf("\n");
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		uclamp_deinit
+ * @BRIEF		free buffers.
+ * @DESCRIPTION		free buffers.
+ *			Must not be called while load threads are running.
+ *//*------------------------------------------------------------------------ */
+void uclamp_deinit(void)
+{
+	unsigned int i;
+
+	if (uthreads == NULL)
+		return;
+	for (i = 0; i < ucount; i++)
+		free(uthreads[i].busy_ns);
+	free(uthreads);
+	uthreads = NULL;
+	ucount = 0;
+}
@@ -0,0 +1,83 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			uclamp.h
+ * @Description			Per-thread utilization clamping and placement
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __UCLAMP_H__
+#define __UCLAMP_H__
+
+#include <stdint.h>
+#include "stats.h"
+
+#define UCLAMP_SCALE		1024	/* SCHED_CAPACITY_SCALE */
+#define UCLAMP_PERIOD_MS	10	/* frequency sampling period */
+
+/*
+ * Utilization clamps of a load thread, and where it ran: busy time per CPU
+ * (accounted by the load thread at the end of each busy slice) and
+ * frequency of the CPU it was on (sampled by a separate thread).
+ */
+struct uclamp_thread {
+	int min;		/* requested clamps, -1: not set */
+	int max;
+	int err;		/* sched_setattr() result */
+	int got_min;		/* clamps read back, -1: unknown */
+	int got_max;
+	int cpu;		/* CPU of last busy slice, -1: none yet */
+	uint64_t migrations;
+	uint64_t *busy_ns;	/* per CPU */
+	double khz_sum;
+	uint64_t khz_samples;
+} __attribute__((aligned(STATS_CACHELINE_SIZE)));
+
+
+int uclamp_init(unsigned int count);
+int uclamp_set(unsigned int cpu, int min, int max);
+int uclamp_enabled(void);
+struct uclamp_thread *uclamp_get(unsigned int cpu);
+void uclamp_place(struct uclamp_thread *u, uint64_t busy_ns);
+int uclamp_thread_apply(unsigned int cpu);
+int uclamp_start(void);
+void uclamp_stop(void);
+void uclamp_report(double secs);
+void uclamp_deinit(void);
+
+
+#endif
@@ -0,0 +1,338 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			verify.c
+ * @Description			Achieved load verification from /proc/stat and schedstat
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include "cpuloadgen.h"
+#include "stats.h"
+#include "verify.h"
+
+
+struct verify_thread {
+	pid_t tid;			/* 0 when not running */
+	struct verify_values final;	/* written by thread before exit */
+	struct verify_values last;	/* last reading, reporter-owned */
+	struct verify_values cpu;	/* /proc/stat deltas of the CPUs it
+					   ran on, reporter-owned */
+};
+
+static struct verify_thread *vthreads = NULL;
+static unsigned int vcount = 0;
+
+/* Latest and previous /proc/stat readings, per CPU (verify_update() only) */
+static uint64_t *cpu_busy = NULL;
+static uint64_t *cpu_total = NULL;	/* 0 if unknown */
+static uint64_t *cpu_steal = NULL;
+static uint64_t *prev_busy = NULL;
+static uint64_t *prev_total = NULL;
+static uint64_t *prev_steal = NULL;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		verify_init
+ * @BRIEF		enable achieved load verification.
+ * @RETURNS		0 on success
+ *			-ENOMEM in case of allocation failure
+ * @param[in]		count: number of CPU cores
+ * @DESCRIPTION		enable achieved load verification.
+ *//*------------------------------------------------------------------------ */
+int verify_init(unsigned int count)
+{
+	vthreads = calloc(count, sizeof(struct verify_thread));
+	cpu_busy = calloc(count, sizeof(uint64_t));
+	cpu_total = calloc(count, sizeof(uint64_t));
+	cpu_steal = calloc(count, sizeof(uint64_t));
+	prev_busy = calloc(count, sizeof(uint64_t));
+	prev_total = calloc(count, sizeof(uint64_t));
+	prev_steal = calloc(count, sizeof(uint64_t));
+	if ((vthreads == NULL) || (cpu_busy == NULL) || (cpu_total == NULL) ||
+		(cpu_steal == NULL) || (prev_busy == NULL) ||
+		(prev_total == NULL) || (prev_steal == NULL)) {
+		verify_deinit();
+		return -ENOMEM;
+	}
+	vcount = count;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		verify_enabled
+ * @BRIEF		tell whether achieved load verification is enabled.
+ * @RETURNS		1 if enabled, 0 otherwise
+ * @DESCRIPTION		tell whether achieved load verification is enabled.
+ *//*------------------------------------------------------------------------ */
+int verify_enabled(void)
+{
+	return vthreads != NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		verify_schedstat
+ * @BRIEF		read a thread's schedstat.
+ * @RETURNS		0 on success, -errno otherwise
+ * @param[in]		tid: thread ID
+ * @param[out]		vals: task_runtime_ns and task_wait_ns updated
+ * @DESCRIPTION		read a thread's schedstat (requires
+ *			CONFIG_SCHED_INFO, i.e. most kernels).
+ *//*------------------------------------------------------------------------ */
+static int verify_schedstat(pid_t tid, struct verify_values *vals)
+{
+	char path[64];
+	unsigned long long run, wait;
+	FILE *fp;
+	int ret;
+
+	snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", (int) tid);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return -errno;
+	ret = fscanf(fp, "%llu %llu", &run, &wait);
+	fclose(fp);
+	if (ret != 2)
+		return -EIO;
+	vals->task_runtime_ns = run;
+	vals->task_wait_ns = wait;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		verify_thread_register
+ * @BRIEF		register calling thread as the load thread of a CPU.
+ * @param[in]		cpu: CPU core ID
+ * @DESCRIPTION		register calling thread as the load thread of a CPU.
+ *//*------------------------------------------------------------------------ */
+void verify_thread_register(unsigned int cpu)
+{
+	if ((vthreads == NULL) || (cpu >= vcount))
+		return;
+	__atomic_store_n(&vthreads[cpu].tid, (pid_t) syscall(SYS_gettid),
+		__ATOMIC_RELEASE);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		verify_thread_unregister
+ * @BRIEF		record final schedstat of calling thread.
+ * @param[in]		cpu: CPU core ID
+ * @DESCRIPTION		record final schedstat of calling thread, so that
+ *			it remains available once the thread has exited.
+ *//*------------------------------------------------------------------------ */
+void verify_thread_unregister(unsigned int cpu)
+{
+	struct verify_values vals;
+
+	if ((vthreads == NULL) || (cpu >= vcount))
+		return;
+	memset(&vals, 0, sizeof(vals));
+	if (verify_schedstat(vthreads[cpu].tid, &vals) == 0)
+		vals.valid = VERIFY_TASK;
+	vthreads[cpu].final = vals;
+	__atomic_store_n(&vthreads[cpu].tid, 0, __ATOMIC_RELEASE);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		procstat_read
+ * @BRIEF		read per-CPU busy and total time from /proc/stat.
+ * @RETURNS		0 on success, -errno otherwise
+ * @param[in]		count: number of CPU cores (size of busy and total)
+ * @param[out]		busy: per-CPU busy ticks (all but idle, iowait and
+ *			steal)
+ * @param[out]		total: per-CPU total ticks (0 if CPU not listed)
+ * @param[out]		steal: per-CPU steal ticks (NULL: not needed)
+ * @DESCRIPTION		read per-CPU busy and total time from /proc/stat,
+ *			in USER_HZ ticks. Time stolen by the hypervisor is
+ *			not busy time: the CPU was not delivered to the guest.
+ *//*------------------------------------------------------------------------ */
+int procstat_read(unsigned int count, uint64_t *busy, uint64_t *total,
+	uint64_t *steal)
+{
+	unsigned long long v[8];
+	char buf[512];
+	unsigned int cpu, i;
+	FILE *fp;
+	int n;
+
+	fp = fopen("/proc/stat", "r");
+	if (fp == NULL)
+		return -errno;
+	memset(total, 0, count * sizeof(uint64_t));
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+		if ((strncmp(buf, "cpu", 3) != 0) || (buf[3] < '0') ||
+			(buf[3] > '9'))
+			continue;
+		memset(v, 0, sizeof(v));
+		/* user nice system idle iowait irq softirq steal guest gnice */
+		n = sscanf(buf, "cpu%u %llu %llu %llu %llu %llu %llu %llu %llu",
+			&cpu, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6],
+			&v[7]);
+		if ((n < 5) || (cpu >= count))
+			continue;
+		/* guest time is already accounted in user time */
+		total[cpu] = 0;
+		for (i = 0; i < 8; i++)
+			total[cpu] += v[i];
+		busy[cpu] = total[cpu] - v[3] - v[4] - v[7];
+		if (steal != NULL)
+			steal[cpu] = v[7];
+	}
+	fclose(fp);
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		verify_update
+ * @BRIEF		sample /proc/stat for all CPUs.
+ * @DESCRIPTION		sample /proc/stat for all CPUs. To be called once
+ *			per reporting interval, before verify_read().
+ *			Load threads are not pinned: the interval's counters
+ *			deltas of the CPU each thread last ran on are added
+ *			to that thread's CPU-observed counters.
+ *//*------------------------------------------------------------------------ */
+void verify_update(void)
+{
+	struct verify_values *c;
+	unsigned int i;
+	int run;
+
+	if (vthreads == NULL)
+		return;
+	memcpy(prev_busy, cpu_busy, vcount * sizeof(uint64_t));
+	memcpy(prev_total, cpu_total, vcount * sizeof(uint64_t));
+	memcpy(prev_steal, cpu_steal, vcount * sizeof(uint64_t));
+	if (procstat_read(vcount, cpu_busy, cpu_total, cpu_steal) != 0)
+		return;
+
+	for (i = 0; i < vcount; i++) {
+		if (stats_slot_get(i) == NULL)
+			continue;
+		run = stats_cpu_get(i);
+		if ((run < 0) || ((unsigned int) run >= vcount) ||
+			(cpu_total[run] == 0))
+			continue;
+		c = &vthreads[i].cpu;
+		if ((prev_total[run] != 0) &&
+			(cpu_total[run] >= prev_total[run])) {
+			c->cpu_busy_ticks += cpu_busy[run] - prev_busy[run];
+			c->cpu_total_ticks += cpu_total[run] - prev_total[run];
+			c->cpu_steal_ticks += cpu_steal[run] - prev_steal[run];
+		}
+		c->valid = VERIFY_CPU;
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		verify_read
+ * @BRIEF		return kernel-side counters of a load thread.
+ * @param[in]		cpu: CPU core ID the thread loads (slot)
+ * @param[out]		vals: cumulative counters
+ * @DESCRIPTION		return kernel-side counters of a load thread and of
+ *			the CPUs it ran on. If the thread has exited, return
+ *			its final values.
+ *//*------------------------------------------------------------------------ */
+void verify_read(unsigned int cpu, struct verify_values *vals)
+{
+	struct verify_thread *t;
+	pid_t tid;
+
+	memset(vals, 0, sizeof(*vals));
+	if ((vthreads == NULL) || (cpu >= vcount))
+		return;
+	t = &vthreads[cpu];
+
+	tid = __atomic_load_n(&t->tid, __ATOMIC_ACQUIRE);
+	if ((tid != 0) && (verify_schedstat(tid, vals) == 0)) {
+		vals->valid |= VERIFY_TASK;
+		t->last = *vals;
+	} else if ((tid == 0) && (t->final.valid & VERIFY_TASK)) {
+		*vals = t->final;
+	} else if (t->last.valid & VERIFY_TASK) {
+		/* thread exiting: hold last reading */
+		*vals = t->last;
+	}
+
+	if (t->cpu.valid & VERIFY_CPU) {
+		vals->cpu_busy_ticks = t->cpu.cpu_busy_ticks;
+		vals->cpu_total_ticks = t->cpu.cpu_total_ticks;
+		vals->cpu_steal_ticks = t->cpu.cpu_steal_ticks;
+		vals->valid |= VERIFY_CPU;
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		verify_deinit
+ * @BRIEF		free verification buffers.
+ * @DESCRIPTION		free verification buffers.
+ *			Must not be called while the reporter is running.
+ *//*------------------------------------------------------------------------ */
+void verify_deinit(void)
+{
+	free(vthreads);
+	free(cpu_busy);
+	free(cpu_total);
+	free(cpu_steal);
+	free(prev_busy);
+	free(prev_total);
+	free(prev_steal);
+	vthreads = NULL;
+	cpu_busy = NULL;
+	cpu_total = NULL;
+	cpu_steal = NULL;
+	prev_busy = NULL;
+	prev_total = NULL;
+	prev_steal = NULL;
+	vcount = 0;
+}
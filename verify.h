@@ -0,0 +1,73 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			verify.h
+ * @Description			Achieved load verification from /proc/stat and schedstat
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __VERIFY_H__
+#define __VERIFY_H__
+
+#include <stdint.h>
+
+#define VERIFY_TASK	(1U << 0)
+#define VERIFY_CPU	(1U << 1)
+
+/* Kernel-side view of a load thread and of the CPUs it ran on */
+struct verify_values {
+	uint64_t task_runtime_ns;	/* schedstat: time spent on CPU */
+	uint64_t task_wait_ns;		/* schedstat: time spent runnable */
+	uint64_t cpu_busy_ticks;	/* /proc/stat: all but idle/iowait/steal */
+	uint64_t cpu_steal_ticks;	/* /proc/stat: steal */
+	uint64_t cpu_total_ticks;	/* /proc/stat: all fields */
+	uint32_t valid;			/* VERIFY_TASK | VERIFY_CPU */
+};
+
+
+int procstat_read(unsigned int count, uint64_t *busy, uint64_t *total,
+	uint64_t *steal);
+int verify_init(unsigned int count);
+int verify_enabled(void);
+void verify_thread_register(unsigned int cpu);
+void verify_thread_unregister(unsigned int cpu);
+void verify_update(void);
+void verify_read(unsigned int cpu, struct verify_values *vals);
+void verify_deinit(void);
+
+
+#endif
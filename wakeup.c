@@ -0,0 +1,262 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			wakeup.c
+ * @Description			Wakeup rate control and per-wakeup cost
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "cpuloadgen.h"
+#include "output.h"
+#include "wakeup.h"
+
+
+static struct wakeup_thread *wakeup_threads = NULL;
+static unsigned int wakeup_count = 0;
+static double wakeup_rate = 0.0;
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		wakeup_init
+ * @BRIEF		enable wakeup rate control.
+ * @RETURNS		0 on success
+ *			-EINVAL in case of invalid rate
+ *			-ENOMEM in case of allocation failure
+ * @param[in]		count: number of CPU cores
+ * @param[in]		rate: target wakeups per second per load thread
+ *			([WAKEUP_MIN_RATE-WAKEUP_MAX_RATE])
+ * @DESCRIPTION		enable wakeup rate control: load threads run fixed
+ *			frames of wakeup_period() (one wakeup each), and
+ *			account the cost of their wakeups.
+ *//*------------------------------------------------------------------------ */
+int wakeup_init(unsigned int count, double rate)
+{
+	if (!(rate >= WAKEUP_MIN_RATE) || (rate > WAKEUP_MAX_RATE))
+		return -EINVAL;
+	if (posix_memalign((void **) &wakeup_threads, STATS_CACHELINE_SIZE,
+		count * sizeof(struct wakeup_thread)) != 0) {
+		wakeup_threads = NULL;
+		return -ENOMEM;
+	}
+	memset(wakeup_threads, 0, count * sizeof(struct wakeup_thread));
+	wakeup_count = count;
+	wakeup_rate = rate;
+
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		wakeup_enabled
+ * @BRIEF		tell whether wakeup rate control is enabled.
+ * @RETURNS		1 if enabled, 0 otherwise
+ * @DESCRIPTION		tell whether wakeup rate control is enabled.
+ *//*------------------------------------------------------------------------ */
+int wakeup_enabled(void)
+{
+	return wakeup_threads != NULL;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		wakeup_period
+ * @BRIEF		return the frame period giving the target wakeup rate.
+ * @RETURNS		frame period in us, 0 if disabled
+ * @DESCRIPTION		return the frame period giving the target wakeup rate.
+ *//*------------------------------------------------------------------------ */
+long int wakeup_period(void)
+{
+	if (wakeup_threads == NULL)
+		return 0;
+	return (long int) (1000000.0 / wakeup_rate + 0.5);
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		wakeup_rusage
+ * @BRIEF		read the calling thread resource usage.
+ * @RETURNS		0 on success, -errno otherwise
+ * @param[out]		nvcsw: voluntary context switches
+ * @param[out]		nivcsw: involuntary context switches
+ * @param[out]		stime_ns: system time, in ns
+ * @DESCRIPTION		read the calling thread resource usage.
+ *//*------------------------------------------------------------------------ */
+static int wakeup_rusage(long *nvcsw, long *nivcsw, uint64_t *stime_ns)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_THREAD, &ru) != 0)
+		return -errno;
+	*nvcsw = ru.ru_nvcsw;
+	*nivcsw = ru.ru_nivcsw;
+	*stime_ns = (uint64_t) ru.ru_stime.tv_sec * NSEC_PER_SEC +
+		(uint64_t) ru.ru_stime.tv_usec * NSEC_PER_USEC;
+	return 0;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		wakeup_thread_begin
+ * @BRIEF		start the calling load thread accounting.
+ * @param[in]		cpu: CPU core ID of the load thread
+ * @DESCRIPTION		start the calling load thread accounting. Must be
+ *			called by the load thread itself, before its first
+ *			frame.
+ *//*------------------------------------------------------------------------ */
+void wakeup_thread_begin(unsigned int cpu)
+{
+	struct wakeup_thread *w;
+
+	if ((wakeup_threads == NULL) || (cpu >= wakeup_count))
+		return;
+	w = &wakeup_threads[cpu];
+	wakeup_rusage(&w->start_nvcsw, &w->start_nivcsw, &w->start_stime_ns);
+	w->start_ns = now_ns();
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		wakeup_thread_end
+ * @BRIEF		stop the calling load thread accounting.
+ * @param[in]		cpu: CPU core ID of the load thread
+ * @param[in]		c: load thread counters
+ * @param[in]		warm_ns: time the first work chunk of each busy
+ *			slice took beyond the steady-state chunk time of the
+ *			same slice, summed over frames
+ * @param[in]		warm_frames: number of frames warm_ns sums
+ * @DESCRIPTION		stop the calling load thread accounting. Must be
+ *			called by the load thread itself, after its last
+ *			frame.
+ *//*------------------------------------------------------------------------ */
+void wakeup_thread_end(unsigned int cpu, const struct stats_counters *c,
+	double warm_ns, uint64_t warm_frames)
+{
+	struct wakeup_thread *w;
+
+	if ((wakeup_threads == NULL) || (cpu >= wakeup_count))
+		return;
+	w = &wakeup_threads[cpu];
+	w->run_ns = now_ns() - w->start_ns;
+	if (wakeup_rusage(&w->nvcsw, &w->nivcsw, &w->stime_ns) != 0)
+		return;
+	w->nvcsw -= w->start_nvcsw;
+	w->nivcsw -= w->start_nivcsw;
+	w->stime_ns -= w->start_stime_ns;
+	w->c = *c;
+	w->warm_ns = warm_ns;
+	w->warm_frames = warm_frames;
+	w->done = 1;
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		wakeup_report
+ * @BRIEF		print and emit achieved wakeup rate and wakeup cost.
+ * @DESCRIPTION		print and emit achieved wakeup rate and wakeup cost per
+ *			load thread: system time, wakeup latency (oversleep)
+ *			and warm-up time (first work chunk after the wakeup
+ *			beyond the steady-state chunk time of the same busy
+ *			slice) per wakeup. Warm-up is unknown for throughput
+ *			targets, whose busy slices are not split in chunks.
+ *			Must be called once load threads are stopped.
+ *//*------------------------------------------------------------------------ */
+void wakeup_report(void)
+{
+	struct wakeup_thread *w;
+	double secs, n, sys_ns, lat_ns, warm_ns;
+	unsigned int cpu;
+
+	if (wakeup_threads == NULL)
+		return;
+
+	iprintf("\nWakeups (target %g/s per thread, cost per wakeup):\n",
+		wakeup_rate);
+	for (cpu = 0; cpu < wakeup_count; cpu++) {
+		w = &wakeup_threads[cpu];
+		if (!w->done || (w->run_ns == 0))
+			continue;
+		secs = (double) w->run_ns / NSEC_PER_SEC;
+		n = w->nvcsw > 0 ? (double) w->nvcsw : 1.0;
+		sys_ns = w->stime_ns / n;
+		lat_ns = w->c.overshoot_ns / n;
+		warm_ns = w->warm_frames ? w->warm_ns / w->warm_frames : 0.0;
+		iprintf("\tCPU%u: %9.1f/s (%ld preempted) sys %7.2fus latency %7.2fus",
+			cpu, w->nvcsw / secs, w->nivcsw, sys_ns / 1000.0,
+			lat_ns / 1000.0);
+		if (w->warm_frames)
+			iprintf(" warm-up %7.2fus\n", warm_ns / 1000.0);
+		else
+			iprintf(" warm-up     n/a\n");
+
+		output_begin("wakeup");
+		output_field_int("cpu", cpu);
+		output_field_double("target", wakeup_rate);
+		output_field_double("achieved", w->nvcsw / secs);
+		output_field_u64("frames", w->c.frames);
+		output_field_int("voluntary", w->nvcsw);
+		output_field_int("involuntary", w->nivcsw);
+		output_field_double("sys_ns", sys_ns);
+		output_field_double("latency_ns", lat_ns);
+		if (w->warm_frames)
+			output_field_double("warmup_ns", warm_ns);
+		else
+			output_field_null("warmup_ns");
+		output_end();
+	}
+}
+
+
+/* ------------------------------------------------------------------------*//**
+ * @FUNCTION		wakeup_deinit
+ * @BRIEF		free buffers.
+ * @DESCRIPTION		free buffers.
+ *			Must not be called while load threads are running.
+ *//*------------------------------------------------------------------------ */
+void wakeup_deinit(void)
+{
+	free(wakeup_threads);
+	wakeup_threads = NULL;
+	wakeup_count = 0;
+	wakeup_rate = 0.0;
+}
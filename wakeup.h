@@ -0,0 +1,82 @@
+/*
+ *
+ * @Component			CPULOADGEN
+ * @Filename			wakeup.h
+ * @Description			Wakeup rate control and per-wakeup cost
+ * @Copyright			Texas Instruments Incorporated
+ *
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __WAKEUP_H__
+#define __WAKEUP_H__
+
+#include <stdint.h>
+#include "stats.h"
+
+/* Wakeups/s range, as period range ([100us-10s]) */
+#define WAKEUP_MIN_RATE		0.1
+#define WAKEUP_MAX_RATE		10000.0
+
+/*
+ * Per-thread accounting, written by the load thread when it starts and
+ * stops, read once load threads are joined.
+ */
+struct wakeup_thread {
+	int done;
+	uint64_t start_ns;
+	uint64_t run_ns;
+	uint64_t stime_ns;	/* in kernel (sleep and wakeup paths...) */
+	long nvcsw;		/* voluntary switches: wakeups */
+	long nivcsw;		/* involuntary switches: preemptions */
+	long start_nvcsw, start_nivcsw;
+	uint64_t start_stime_ns;
+	struct stats_counters c;
+	double warm_ns;		/* first chunk excess, summed over frames */
+	uint64_t warm_frames;	/* frames with more than one chunk */
+} __attribute__((aligned(STATS_CACHELINE_SIZE)));
+
+
+int wakeup_init(unsigned int count, double rate);
+int wakeup_enabled(void);
+long int wakeup_period(void);
+void wakeup_thread_begin(unsigned int cpu);
+void wakeup_thread_end(unsigned int cpu, const struct stats_counters *c,
+	double warm_ns, uint64_t warm_frames);
+void wakeup_report(void);
+void wakeup_deinit(void);
+
+
+#endif